@@ -39,6 +39,7 @@ SOURCES +=  qwaylandintegration.cpp \
             qwaylandshmbackingstore.cpp \
             qwaylandinputdevice.cpp \
             qwaylanddisplay.cpp \
+            qwaylandeventthread.cpp \
             qwaylandwindow.cpp \
             qwaylandscreen.cpp \
             qwaylandshmwindow.cpp \
@@ -69,6 +70,7 @@ SOURCES +=  qwaylandintegration.cpp \
 HEADERS +=  qwaylandintegration_p.h \
             qwaylandnativeinterface_p.h \
             qwaylanddisplay_p.h \
+            qwaylandeventthread_p.h \
             qwaylandwindow_p.h \
             qwaylandscreen_p.h \
             qwaylandshmbackingstore_p.h \
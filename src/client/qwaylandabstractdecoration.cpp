@@ -45,13 +45,74 @@
 #include "qwaylandshellsurface_p.h"
 #include "qwaylandinputdevice_p.h"
 #include "qwaylandscreen_p.h"
+#include "qwaylanddisplay_p.h"
+#include "qwaylandshmbackingstore_p.h"
 
 #include <QtGui/QImage>
+#include <QtGui/QPainter>
 
 QT_BEGIN_NAMESPACE
 
 namespace QtWaylandClient {
 
+// Looks like the whole frame to the decoration's paint(), while QPainter
+// redirects the painting into the image of a single edge.
+class QWaylandDecorationEdgeDevice : public QPaintDevice
+{
+public:
+    QWaylandDecorationEdgeDevice(QImage *image, const QPoint &offset, const QSize &frameSize)
+        : m_image(image)
+        , m_offset(offset)
+        , m_frameSize(frameSize)
+    {
+    }
+
+    QPaintEngine *paintEngine() const override { return m_image->paintEngine(); }
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmWidth:
+            return m_frameSize.width() * m_image->devicePixelRatio();
+        case PdmHeight:
+            return m_frameSize.height() * m_image->devicePixelRatio();
+        case PdmWidthMM:
+            return m_image->widthMM() * m_frameSize.width() / qMax(1, m_image->width());
+        case PdmHeightMM:
+            return m_image->heightMM() * m_frameSize.height() / qMax(1, m_image->height());
+        case PdmNumColors:
+            return m_image->colorCount();
+        case PdmDepth:
+            return m_image->depth();
+        case PdmDpiX:
+            return m_image->logicalDpiX();
+        case PdmDpiY:
+            return m_image->logicalDpiY();
+        case PdmPhysicalDpiX:
+            return m_image->physicalDpiX();
+        case PdmPhysicalDpiY:
+            return m_image->physicalDpiY();
+        case PdmDevicePixelRatio:
+            return m_image->devicePixelRatio();
+        case PdmDevicePixelRatioScaled:
+            return m_image->devicePixelRatioF() * devicePixelRatioFScale();
+        }
+        return 0;
+    }
+
+    QPaintDevice *redirected(QPoint *offset) const override
+    {
+        *offset = m_offset;
+        return m_image;
+    }
+
+private:
+    QImage *m_image;
+    QPoint m_offset;
+    QSize m_frameSize;
+};
+
 class QWaylandAbstractDecorationPrivate : public QObjectPrivate
 {
     Q_DECLARE_PUBLIC(QWaylandAbstractDecoration)
@@ -66,7 +127,30 @@ public:
     bool m_isDirty;
     QImage m_decorationContentImage;
 
+    // Only the strips around the content are painted, and each one only
+    // again when it was updated or changed size or position
+    QImage m_edgeImages[QWaylandAbstractDecoration::EdgeCount];
+    QPoint m_edgeOffsets[QWaylandAbstractDecoration::EdgeCount]; // in frame coordinates
+    bool m_edgeDirty[QWaylandAbstractDecoration::EdgeCount];
+
     Qt::MouseButtons m_mouseButtons;
+
+    // The edges, when they are put in subsurfaces around the window's
+    // own surface instead of into its buffers
+    struct DecorationSurface {
+        DecorationSurface() : surface(0), subSurface(0), imageKey(0) { buffers[0] = buffers[1] = 0; }
+
+        struct ::wl_surface *surface;
+        struct ::wl_subsurface *subSurface;
+        QWaylandShmBuffer *buffers[2];
+        QRect rect; // in frame coordinates
+        qint64 imageKey; // of the edge image last committed
+    };
+
+    bool m_useSubSurfaces;
+    DecorationSurface m_surfaces[QWaylandAbstractDecoration::EdgeCount];
+
+    QWaylandShmBuffer *subSurfaceBuffer(DecorationSurface &surface, const QSize &size, int scale);
 };
 
 QWaylandAbstractDecorationPrivate::QWaylandAbstractDecorationPrivate()
@@ -75,13 +159,33 @@ QWaylandAbstractDecorationPrivate::QWaylandAbstractDecorationPrivate()
     , m_isDirty(true)
     , m_decorationContentImage(0)
     , m_mouseButtons(Qt::NoButton)
+    , m_useSubSurfaces(false)
 {
+    for (bool &dirty : m_edgeDirty)
+        dirty = true;
 }
 
 QWaylandAbstractDecorationPrivate::~QWaylandAbstractDecorationPrivate()
 {
 }
 
+// Returns a buffer that is not held by the compositor, or 0 if both are
+QWaylandShmBuffer *QWaylandAbstractDecorationPrivate::subSurfaceBuffer(DecorationSurface &surface, const QSize &size, int scale)
+{
+    for (QWaylandShmBuffer *buffer : surface.buffers) {
+        if (buffer && !buffer->busy() && buffer->size() == size)
+            return buffer;
+    }
+    for (QWaylandShmBuffer *&buffer : surface.buffers) {
+        if (!buffer || !buffer->busy()) {
+            delete buffer;
+            buffer = new QWaylandShmBuffer(m_wayland_window->display(), size, QImage::Format_ARGB32_Premultiplied, scale);
+            return buffer;
+        }
+    }
+    return 0;
+}
+
 QWaylandAbstractDecoration::QWaylandAbstractDecoration()
     : QObject(*new QWaylandAbstractDecorationPrivate)
 {
@@ -89,6 +193,7 @@ QWaylandAbstractDecoration::QWaylandAbstractDecoration()
 
 QWaylandAbstractDecoration::~QWaylandAbstractDecoration()
 {
+    destroySubSurfaces();
 }
 
 // we do this as a setter to get around plugin factory creates not really
@@ -102,8 +207,13 @@ void QWaylandAbstractDecoration::setWaylandWindow(QWaylandWindow *window)
 
     d->m_window = window->window();
     d->m_wayland_window = window;
+
+    static bool subSurfacesDisabled = qEnvironmentVariableIsSet("QT_WAYLAND_DECORATION_SUBSURFACES")
+            && !qEnvironmentVariableIntValue("QT_WAYLAND_DECORATION_SUBSURFACES");
+    d->m_useSubSurfaces = !subSurfacesDisabled && window->display()->hasSubCompositor();
 }
 
+// The whole decoration in one image, assembled from the edges
 const QImage &QWaylandAbstractDecoration::contentImage()
 {
     Q_D(QWaylandAbstractDecoration);
@@ -112,10 +222,16 @@ const QImage &QWaylandAbstractDecoration::contentImage()
 
         const int scale = waylandWindow()->scale();
         const QSize imageSize = window()->frameGeometry().size() * scale;
-        d->m_decorationContentImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+        if (d->m_decorationContentImage.size() != imageSize) {
+            d->m_decorationContentImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+            d->m_decorationContentImage.fill(Qt::transparent);
+        }
         d->m_decorationContentImage.setDevicePixelRatio(scale);
-        d->m_decorationContentImage.fill(Qt::transparent);
-        this->paint(&d->m_decorationContentImage);
+
+        QPainter painter(&d->m_decorationContentImage);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        for (int edge = 0; edge < EdgeCount; ++edge)
+            painter.drawImage(edgeRect(Edge(edge)).topLeft(), edgeImage(Edge(edge)));
 
         d->m_isDirty = false;
     }
@@ -123,10 +239,192 @@ const QImage &QWaylandAbstractDecoration::contentImage()
     return d->m_decorationContentImage;
 }
 
+// Returns the area of an edge in frame coordinates
+QRect QWaylandAbstractDecoration::edgeRect(Edge edge) const
+{
+    const QSize frameSize = window()->frameGeometry().size();
+    const QMargins m = margins();
+    const int contentHeight = frameSize.height() - m.top() - m.bottom();
+
+    switch (edge) {
+    case TopEdge:
+        return QRect(0, 0, frameSize.width(), m.top());
+    case LeftEdge:
+        return QRect(0, m.top(), m.left(), contentHeight);
+    case RightEdge:
+        return QRect(frameSize.width() - m.right(), m.top(), m.right(), contentHeight);
+    case BottomEdge:
+        return QRect(0, frameSize.height() - m.bottom(), frameSize.width(), m.bottom());
+    case EdgeCount:
+        break;
+    }
+    return QRect();
+}
+
+// Returns the image of an edge, painting it first if it was updated or moved or
+// its size changed. Moved edges are painted again too, since the decoration
+// may lay them out relative to the frame.
+const QImage &QWaylandAbstractDecoration::edgeImage(Edge edge)
+{
+    Q_D(QWaylandAbstractDecoration);
+    const int scale = waylandWindow()->scale();
+    const QRect rect = edgeRect(edge);
+    QImage &image = d->m_edgeImages[edge];
+
+    if (d->m_edgeDirty[edge] || image.size() != rect.size() * scale || image.devicePixelRatio() != scale
+            || d->m_edgeOffsets[edge] != rect.topLeft()) {
+        if (image.size() != rect.size() * scale)
+            image = QImage(rect.size() * scale, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(scale);
+        image.fill(Qt::transparent);
+        if (!image.isNull()) {
+            QWaylandDecorationEdgeDevice device(&image, rect.topLeft(), window()->frameGeometry().size());
+            this->paint(&device);
+        }
+        d->m_edgeOffsets[edge] = rect.topLeft();
+        d->m_edgeDirty[edge] = false;
+    }
+
+    // Clean once all the edges were brought up to date
+    d->m_isDirty = false;
+    for (bool dirty : d->m_edgeDirty)
+        d->m_isDirty |= dirty;
+
+    return image;
+}
+
+// Whether the decoration is put in subsurfaces of its own instead of being
+// drawn into the window's buffers. The window's surface then only holds the
+// content, and the decoration is only committed again when it changes.
+bool QWaylandAbstractDecoration::usesSubSurfaces() const
+{
+    Q_D(const QWaylandAbstractDecoration);
+    return d->m_useSubSurfaces;
+}
+
+// Updates the decoration subsurfaces if the decoration is dirty. They are
+// synchronized, so the changes are applied with the next commit of the window.
+void QWaylandAbstractDecoration::commitSubSurfaces()
+{
+    Q_D(QWaylandAbstractDecoration);
+    QWaylandWindow *window = d->m_wayland_window;
+    if (!d->m_useSubSurfaces || !window->isInitialized())
+        return;
+
+    bool created = false;
+    for (QWaylandAbstractDecorationPrivate::DecorationSurface &s : d->m_surfaces) {
+        if (!s.surface) {
+            s.surface = window->display()->createSurface(static_cast<QtWayland::wl_surface *>(window));
+            s.subSurface = window->display()->createSubSurface(s.surface, window->object());
+            created = true;
+        }
+    }
+    if (!d->m_isDirty && !created)
+        return;
+
+    const int scale = window->scale();
+    const QMargins m = margins();
+    bool retry = false;
+
+    for (int edge = 0; edge < EdgeCount; ++edge) {
+        QWaylandAbstractDecorationPrivate::DecorationSurface &s = d->m_surfaces[edge];
+        const QRect rect = edgeRect(Edge(edge));
+
+        // Positions are relative to the window's surface, which starts at the content
+        if (rect.topLeft() != s.rect.topLeft() || !s.imageKey)
+            wl_subsurface_set_position(s.subSurface, rect.x() - m.left(), rect.y() - m.top());
+
+        if (rect.isEmpty()) {
+            if (s.imageKey || created) {
+                wl_surface_attach(s.surface, 0, 0, 0);
+                wl_surface_commit(s.surface);
+            }
+            s.rect = rect;
+            s.imageKey = 0;
+            continue;
+        }
+
+        // Edges that were not painted again keep their buffer
+        const QImage &image = edgeImage(Edge(edge));
+        if (image.cacheKey() == s.imageKey && rect.size() == s.rect.size()) {
+            s.rect = rect;
+            continue;
+        }
+
+        QWaylandShmBuffer *buffer = d->subSurfaceBuffer(s, image.size(), scale);
+        if (!buffer) {
+            retry = true;
+            continue;
+        }
+
+        QPainter painter(buffer->image());
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(QPoint(), image);
+        painter.end();
+
+        if (window->display()->compositorVersion() >= 3)
+            wl_surface_set_buffer_scale(s.surface, scale);
+        wl_surface_attach(s.surface, buffer->buffer(), 0, 0);
+        buffer->setBusy();
+        wl_surface_damage(s.surface, 0, 0, rect.width(), rect.height());
+        wl_surface_commit(s.surface);
+
+        s.rect = rect;
+        s.imageKey = image.cacheKey();
+    }
+
+    // Edges whose buffers were all busy are tried again with the next frame
+    d->m_isDirty = retry;
+}
+
+// Called before the window's surface goes away
+void QWaylandAbstractDecoration::destroySubSurfaces()
+{
+    Q_D(QWaylandAbstractDecoration);
+    for (QWaylandAbstractDecorationPrivate::DecorationSurface &s : d->m_surfaces) {
+        if (s.subSurface)
+            wl_subsurface_destroy(s.subSurface);
+        if (s.surface)
+            wl_surface_destroy(s.surface);
+        for (QWaylandShmBuffer *buffer : s.buffers)
+            delete buffer;
+        s = QWaylandAbstractDecorationPrivate::DecorationSurface();
+    }
+    // Recreated and filled again with the next commit
+    d->m_isDirty = true;
+}
+
+// Returns what needs to be added to positions local to surface, which is
+// either the window's own surface or one of the decoration subsurfaces, to
+// get positions in frame coordinates.
+QPoint QWaylandAbstractDecoration::subSurfaceOffset(struct ::wl_surface *surface) const
+{
+    Q_D(const QWaylandAbstractDecoration);
+    for (const QWaylandAbstractDecorationPrivate::DecorationSurface &s : d->m_surfaces) {
+        if (s.surface && s.surface == surface)
+            return s.rect.topLeft();
+    }
+    const QMargins m = margins();
+    return QPoint(m.left(), m.top());
+}
+
 void QWaylandAbstractDecoration::update()
 {
     Q_D(QWaylandAbstractDecoration);
     d->m_isDirty = true;
+    for (bool &dirty : d->m_edgeDirty)
+        dirty = true;
+}
+
+// Only paints the edges intersecting rect, given in frame coordinates, again
+void QWaylandAbstractDecoration::update(const QRect &rect)
+{
+    Q_D(QWaylandAbstractDecoration);
+    d->m_isDirty = true;
+    for (int edge = 0; edge < EdgeCount; ++edge) {
+        if (edgeRect(Edge(edge)).intersects(rect))
+            d->m_edgeDirty[edge] = true;
+    }
 }
 
 void QWaylandAbstractDecoration::setMouseButtons(Qt::MouseButtons mb)
@@ -84,6 +84,8 @@ class Q_WAYLAND_CLIENT_EXPORT QWaylandAbstractDecoration : public QObject
     Q_OBJECT
     Q_DECLARE_PRIVATE(QWaylandAbstractDecoration)
 public:
+    enum Edge { TopEdge, LeftEdge, RightEdge, BottomEdge, EdgeCount };
+
     QWaylandAbstractDecoration();
     virtual ~QWaylandAbstractDecoration();
 
@@ -91,12 +93,21 @@ public:
     QWaylandWindow *waylandWindow() const;
 
     void update();
+    void update(const QRect &rect);
     bool isDirty() const;
 
     virtual QMargins margins() const = 0;
     QWindow *window() const;
     const QImage &contentImage();
 
+    QRect edgeRect(Edge edge) const;
+    const QImage &edgeImage(Edge edge);
+
+    bool usesSubSurfaces() const;
+    void commitSubSurfaces();
+    void destroySubSurfaces();
+    QPoint subSurfaceOffset(struct ::wl_surface *surface) const;
+
     virtual bool handleMouse(QWaylandInputDevice *inputDevice, const QPointF &local, const QPointF &global,Qt::MouseButtons b,Qt::KeyboardModifiers mods) = 0;
     virtual bool handleTouch(QWaylandInputDevice *inputDevice, const QPointF &local, const QPointF &global, Qt::TouchPointState state, Qt::KeyboardModifiers mods) = 0;
 
@@ -49,6 +49,7 @@ namespace QtWaylandClient {
 QWaylandBuffer::QWaylandBuffer()
               : mBuffer(0)
               , mBusy(false)
+              , mReleaseLatency(-1)
 {
 }
 
@@ -66,7 +67,10 @@ void QWaylandBuffer::init(wl_buffer *buf)
 
 void QWaylandBuffer::release(void *data, wl_buffer *)
 {
-    static_cast<QWaylandBuffer *>(data)->mBusy = false;
+    QWaylandBuffer *self = static_cast<QWaylandBuffer *>(data);
+    self->mBusy = false;
+    if (self->mBusyTimer.isValid())
+        self->mReleaseLatency = self->mBusyTimer.elapsed();
 }
 
 const wl_buffer_listener QWaylandBuffer::listener = {
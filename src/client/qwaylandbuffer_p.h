@@ -55,6 +55,7 @@
 
 #include <QtCore/QSize>
 #include <QtCore/QRect>
+#include <QtCore/QElapsedTimer>
 
 #include <wayland-client.h>
 #include <wayland-client-protocol.h>
@@ -73,14 +74,20 @@ public:
     virtual QSize size() const = 0;
     virtual int scale() const { return 1; }
 
-    void setBusy() { mBusy = true; }
+    void setBusy() { mBusy = true; mBusyTimer.start(); }
     bool busy() const { return mBusy; }
 
+    // Milliseconds the compositor held on to the buffer after it was last
+    // attached, or -1 if it hasn't been released since the last call.
+    qint64 takeReleaseLatency() { qint64 latency = mReleaseLatency; mReleaseLatency = -1; return latency; }
+
 protected:
     struct wl_buffer *mBuffer;
 
 private:
     bool mBusy;
+    QElapsedTimer mBusyTimer;
+    qint64 mReleaseLatency;
 
     static void release(void *data, wl_buffer *);
     static const wl_buffer_listener listener;
@@ -45,6 +45,7 @@
 #include <QtGui/private/qguiapplication_p.h>
 #include <qpa/qplatformclipboard.h>
 
+#include <QtCore/QDeadlineTimer>
 #include <QtCore/QDebug>
 
 QT_BEGIN_NAMESPACE
@@ -141,6 +142,11 @@ QVariant QWaylandMimeData::retrieveData_sys(const QString &mimeType, QVariant::T
         return QVariant();
     }
 
+#ifdef F_SETPIPE_SZ
+    // Fewer round trips through the pipe for big contents, failing is harmless
+    fcntl(pipefd[1], F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
     m_dataOffer->receive(mime, pipefd[1]);
     wl_display_flush(m_display->wl_display());
 
@@ -159,23 +165,50 @@ QVariant QWaylandMimeData::retrieveData_sys(const QString &mimeType, QVariant::T
 
 int QWaylandMimeData::readData(int fd, QByteArray &data) const
 {
-    char buf[4096];
-    int retryCount = 0;
-    int n;
-    while (true) {
-        n = QT_READ(fd, buf, sizeof buf);
-        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) && ++retryCount < 1000)
-            usleep(1000);
-        else
-            break;
-    }
-    if (retryCount >= 1000)
-        qWarning("QWaylandDataOffer: timeout reading from pipe");
-    if (n > 0) {
-        data.append(buf, n);
-        n = readData(fd, data);
+    // QMimeData::data() has to return the complete contents before it
+    // returns, and processing events meanwhile could run code that destroys
+    // this offer. So the pipe is waited on with poll(), which wakes up as
+    // soon as the source has written more. How long the caller can be held
+    // up is bounded: by a short timeout while the source sends nothing, and
+    // by an overall deadline for slow sources.
+    static const qint64 stallTimeout = 1000; // ms
+    static const qint64 totalTimeout = 5000; // ms
+    static const int maxChunkSize = 4 * 1024 * 1024;
+
+    const QDeadlineTimer deadline(totalTimeout);
+    QDeadlineTimer stallDeadline(stallTimeout);
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int chunkSize = 64 * 1024;
+    forever {
+        const int oldSize = data.size();
+        data.resize(oldSize + chunkSize);
+        const qint64 n = QT_READ(fd, data.data() + oldSize, chunkSize);
+        data.resize(oldSize + int(qMax<qint64>(n, 0)));
+
+        if (n > 0) {
+            // Large transfers are read in growing chunks
+            if (n == chunkSize && chunkSize < maxChunkSize)
+                chunkSize *= 2;
+            stallDeadline.setRemainingTime(stallTimeout);
+            continue;
+        }
+        if (n == 0)
+            return 0;
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+
+        const qint64 wait = qMin(deadline.remainingTimeNSecs(), stallDeadline.remainingTimeNSecs());
+        const struct timespec timeout = { time_t(wait / 1000000000), long(wait % 1000000000) };
+        const int ready = wait > 0 ? qt_safe_poll(&pfd, 1, &timeout) : 0;
+        if (ready == 0) {
+            qWarning("QWaylandDataOffer: timeout reading from pipe");
+            return -1;
+        }
+        if (ready < 0)
+            return -1;
     }
-    return n;
 }
 
 }
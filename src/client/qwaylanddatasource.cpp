@@ -40,22 +40,107 @@
 #include "qwaylanddatasource_p.h"
 #include "qwaylanddataoffer_p.h"
 #include "qwaylanddatadevicemanager_p.h"
+#include "qwaylanddisplay_p.h"
 #include "qwaylandinputdevice_p.h"
 #include "qwaylandmimehelper_p.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QSocketNotifier>
 
 #include <QtCore/QDebug>
 
 #include <unistd.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
 
 QT_BEGIN_NAMESPACE
 
 namespace QtWaylandClient {
 
+// Writes contents to a receiver whenever it is ready for more, so that a slow
+// receiver doesn't block us. Transfers don't depend on the data source, which
+// may be replaced or cancelled while a receiver is still reading.
+class QWaylandDataSourceTransfer : public QObject
+{
+public:
+    QWaylandDataSourceTransfer(int fd, const QByteArray &content, QObject *parent);
+    ~QWaylandDataSourceTransfer();
+
+    void start();
+
+private:
+    bool write();
+
+    int m_fd;
+    QByteArray m_content;
+    int m_written;
+    QSocketNotifier *m_notifier;
+};
+
+QWaylandDataSourceTransfer::QWaylandDataSourceTransfer(int fd, const QByteArray &content, QObject *parent)
+    : QObject(parent)
+    , m_fd(fd)
+    , m_content(content)
+    , m_written(0)
+    , m_notifier(nullptr)
+{
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+}
+
+QWaylandDataSourceTransfer::~QWaylandDataSourceTransfer()
+{
+    close(m_fd);
+}
+
+void QWaylandDataSourceTransfer::start()
+{
+    if (write())
+        return;
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Write, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &QWaylandDataSourceTransfer::write);
+}
+
+// Writes as much as the pipe takes without blocking. Returns true, after
+// scheduling its own deletion, once everything was written or the receiver
+// went away.
+bool QWaylandDataSourceTransfer::write()
+{
+    // Ignore SIGPIPE, or clients may be forced to terminate if the pipe is
+    // closed in the other end.
+    struct sigaction action, oldAction;
+    action.sa_handler = SIG_IGN;
+    sigemptyset (&action.sa_mask);
+    action.sa_flags = 0;
+    sigaction(SIGPIPE, &action, &oldAction);
+
+    bool done = true;
+    while (m_written < m_content.size()) {
+        const ssize_t n = ::write(m_fd, m_content.constData() + m_written, m_content.size() - m_written);
+        if (n > 0) {
+            m_written += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            done = n < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+            break;
+        }
+    }
+
+    sigaction(SIGPIPE, &oldAction, nullptr);
+
+    if (done) {
+        if (m_notifier)
+            m_notifier->setEnabled(false);
+        deleteLater();
+    }
+    return done;
+}
+
 QWaylandDataSource::QWaylandDataSource(QWaylandDataDeviceManager *dataDeviceManager, QMimeData *mimeData)
     : QtWayland::wl_data_source(dataDeviceManager->create_data_source())
+    , m_display(dataDeviceManager->display())
     , m_mime_data(mimeData)
 {
     if (!mimeData)
@@ -82,20 +167,21 @@ void QWaylandDataSource::data_source_cancelled()
 
 void QWaylandDataSource::data_source_send(const QString &mime_type, int32_t fd)
 {
-    QByteArray content = QWaylandMimeHelper::getByteArray(m_mime_data, mime_type);
-    if (!content.isEmpty()) {
-        // Create a sigpipe handler that does nothing, or clients may be forced to terminate
-        // if the pipe is closed in the other end.
-        struct sigaction action, oldAction;
-        action.sa_handler = SIG_IGN;
-        sigemptyset (&action.sa_mask);
-        action.sa_flags = 0;
-
-        sigaction(SIGPIPE, &action, &oldAction);
-        write(fd, content.constData(), content.size());
-        sigaction(SIGPIPE, &oldAction, nullptr);
+    // Encoding e.g. images is expensive, and clipboard managers and repeated
+    // pastes ask for the same contents over and over.
+    auto it = m_contents.constFind(mime_type);
+    if (it == m_contents.constEnd())
+        it = m_contents.insert(mime_type, QWaylandMimeHelper::getByteArray(m_mime_data, mime_type));
+
+    if (it->isEmpty()) {
+        close(fd);
+        return;
     }
-    close(fd);
+
+    // Owned by the display rather than by us, so that it can finish even if
+    // this source goes away first.
+    QWaylandDataSourceTransfer *transfer = new QWaylandDataSourceTransfer(fd, *it, m_display);
+    transfer->start();
 }
 
 void QWaylandDataSource::data_source_target(const QString &mime_type)
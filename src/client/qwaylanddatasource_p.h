@@ -52,6 +52,7 @@
 //
 
 #include <QObject>
+#include <QHash>
 
 #include <QtWaylandClient/private/qwayland-wayland.h>
 #include <QtWaylandClient/private/qtwaylandclientglobal_p.h>
@@ -88,6 +89,7 @@ protected:
 private:
     QWaylandDisplay *m_display;
     QMimeData *m_mime_data;
+    QHash<QString, QByteArray> m_contents;
 };
 
 }
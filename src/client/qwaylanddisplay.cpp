@@ -41,6 +41,7 @@
 
 #include "qwaylandintegration_p.h"
 #include "qwaylandwindow_p.h"
+#include "qwaylandeventthread_p.h"
 #include "qwaylandscreen_p.h"
 #include "qwaylandcursor_p.h"
 #include "qwaylandinputdevice_p.h"
@@ -69,6 +70,7 @@
 #include <QtWaylandClient/private/qwayland-xdg-shell.h>
 
 #include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QHash>
 #include <QtGui/private/qguiapplication_p.h>
 
 #include <QtCore/QDebug>
@@ -104,12 +106,17 @@ struct ::wl_region *QWaylandDisplay::createRegion(const QRegion &qregion)
 }
 
 ::wl_subsurface *QWaylandDisplay::createSubSurface(QWaylandWindow *window, QWaylandWindow *parent)
+{
+    return createSubSurface(window->object(), parent->object());
+}
+
+::wl_subsurface *QWaylandDisplay::createSubSurface(::wl_surface *surface, ::wl_surface *parent)
 {
     if (!mSubCompositor) {
         return NULL;
     }
 
-    return mSubCompositor->get_subsurface(window->object(), parent->object());
+    return mSubCompositor->get_subsurface(surface, parent);
 }
 
 QWaylandClientBufferIntegration * QWaylandDisplay::clientBufferIntegration() const
@@ -138,6 +145,8 @@ QWaylandDisplay::QWaylandDisplay(QWaylandIntegration *waylandIntegration)
     , mLastInputWindow(0)
     , mLastKeyboardFocus(Q_NULLPTR)
     , mSyncCallback(Q_NULLPTR)
+    , mScreensSyncCallback(Q_NULLPTR)
+    , mScreensCoveredBySync(0)
 {
     qRegisterMetaType<uint32_t>("uint32_t");
 
@@ -152,11 +161,18 @@ QWaylandDisplay::QWaylandDisplay(QWaylandIntegration *waylandIntegration)
 
     mWindowManagerIntegration.reset(new QWaylandWindowManagerIntegration(this));
 
+    // The first roundtrip announces and binds all the globals, the second one
+    // collects the events of all outputs and of the hardware integration at once
     forceRoundTrip();
+    requestScreensSync();
+    if (!mPendingScreens.isEmpty() || mHardwareIntegration)
+        forceRoundTrip();
 }
 
 QWaylandDisplay::~QWaylandDisplay(void)
 {
+    mEventThread.reset();
+
     qDeleteAll(mInputDevices);
     mInputDevices.clear();
 
@@ -164,6 +180,8 @@ QWaylandDisplay::~QWaylandDisplay(void)
         mWaylandIntegration->destroyScreen(screen);
     }
     mScreens.clear();
+    qDeleteAll(mPendingScreens);
+    mPendingScreens.clear();
 #if QT_CONFIG(wayland_datadevice)
     delete mDndSelectionHandler.take();
 #endif
@@ -183,18 +201,32 @@ void QWaylandDisplay::checkError() const
 
 void QWaylandDisplay::flushRequests()
 {
-    if (wl_display_prepare_read(mDisplay) == 0) {
+    // With an event thread, reading is left to it, as wl_display_read_events()
+    // would block here until it wakes up.
+    if (mEventThread)
+        mEventThread->eventsDispatched();
+    else if (wl_display_prepare_read(mDisplay) == 0)
         wl_display_read_events(mDisplay);
-    }
 
     if (wl_display_dispatch_pending(mDisplay) < 0) {
         checkError();
         exitWithError();
     }
 
+    dispatchFrameCallbacks();
+
     wl_display_flush(mDisplay);
 }
 
+// Called from the main thread, and from the event thread if there is one, so
+// that frame callbacks don't have to wait for the main thread.
+void QWaylandDisplay::dispatchFrameCallbacks()
+{
+    QMutexLocker locker(&mWindowsMutex);
+    for (QWaylandWindow *window : qAsConst(mWindows))
+        window->dispatchFrameCallbacks();
+}
+
 
 void QWaylandDisplay::blockingReadEvents()
 {
@@ -204,6 +236,22 @@ void QWaylandDisplay::blockingReadEvents()
     }
 }
 
+void QWaylandDisplay::blockingReadEvents(struct ::wl_event_queue *queue)
+{
+    if (wl_display_dispatch_queue(mDisplay, queue) < 0) {
+        checkError();
+        exitWithError();
+    }
+}
+
+void QWaylandDisplay::startEventThread()
+{
+    if (mEventThread)
+        return;
+    mEventThread.reset(new QWaylandEventThread(this));
+    mEventThread->start();
+}
+
 void QWaylandDisplay::exitWithError()
 {
     ::exit(1);
@@ -238,49 +286,94 @@ void QWaylandDisplay::waitForScreens()
     }
 }
 
+enum RegistryInterface {
+    UnknownInterface,
+    OutputInterface,
+    CompositorInterface,
+    ShmInterface,
+    SeatInterface,
+    DataDeviceManagerInterface,
+    SurfaceExtensionInterface,
+    SubCompositorInterface,
+    TouchExtensionInterface,
+    KeyExtensionInterface,
+    TextInputManagerInterface,
+    HardwareIntegrationInterface
+};
+
+static RegistryInterface registryInterface(const QString &interface)
+{
+    static const QHash<QString, RegistryInterface> interfaces = {
+        { QStringLiteral("wl_output"), OutputInterface },
+        { QStringLiteral("wl_compositor"), CompositorInterface },
+        { QStringLiteral("wl_shm"), ShmInterface },
+        { QStringLiteral("wl_seat"), SeatInterface },
+        { QStringLiteral("wl_data_device_manager"), DataDeviceManagerInterface },
+        { QStringLiteral("qt_surface_extension"), SurfaceExtensionInterface },
+        { QStringLiteral("wl_subcompositor"), SubCompositorInterface },
+        { QStringLiteral("qt_touch_extension"), TouchExtensionInterface },
+        { QStringLiteral("qt_key_extension"), KeyExtensionInterface },
+        { QStringLiteral("zwp_text_input_manager_v2"), TextInputManagerInterface },
+        { QStringLiteral("qt_hardware_integration"), HardwareIntegrationInterface }
+    };
+    return interfaces.value(interface, UnknownInterface);
+}
+
 void QWaylandDisplay::registry_global(uint32_t id, const QString &interface, uint32_t version)
 {
     Q_UNUSED(version);
 
     struct ::wl_registry *registry = object();
 
-    if (interface == QStringLiteral("wl_output")) {
-        QWaylandScreen *screen = new QWaylandScreen(this, version, id);
-        mScreens.append(screen);
-        // We need to get the output events before creating surfaces
-        forceRoundTrip();
-        screen->init();
-        mWaylandIntegration->screenAdded(screen);
-    } else if (interface == QStringLiteral("wl_compositor")) {
+    switch (registryInterface(interface)) {
+    case OutputInterface:
+        // We need to get the output events before creating surfaces, the screen
+        // is added once a sync sent after the bind is done. The sync is only
+        // requested after the rest of the registry events, so that outputs
+        // announced together share it.
+        mPendingScreens.append(new QWaylandScreen(this, version, id));
+        QMetaObject::invokeMethod(this, "requestScreensSync", Qt::QueuedConnection);
+        break;
+    case CompositorInterface:
         mCompositorVersion = qMin((int)version, 3);
         mCompositor.init(registry, id, mCompositorVersion);
-    } else if (interface == QStringLiteral("wl_shm")) {
+        break;
+    case ShmInterface:
         mShm.reset(new QWaylandShm(this, version, id));
-    } else if (interface == QStringLiteral("wl_seat")) {
-        QWaylandInputDevice *inputDevice = mWaylandIntegration->createInputDevice(this, version, id);
-        mInputDevices.append(inputDevice);
+        break;
+    case SeatInterface:
+        mInputDevices.append(mWaylandIntegration->createInputDevice(this, version, id));
+        break;
+    case DataDeviceManagerInterface:
 #if QT_CONFIG(wayland_datadevice)
-    } else if (interface == QStringLiteral("wl_data_device_manager")) {
         mDndSelectionHandler.reset(new QWaylandDataDeviceManager(this, id));
 #endif
-    } else if (interface == QStringLiteral("qt_surface_extension")) {
+        break;
+    case SurfaceExtensionInterface:
         mWindowExtension.reset(new QtWayland::qt_surface_extension(registry, id, 1));
-    } else if (interface == QStringLiteral("wl_subcompositor")) {
+        break;
+    case SubCompositorInterface:
         mSubCompositor.reset(new QtWayland::wl_subcompositor(registry, id, 1));
-    } else if (interface == QStringLiteral("qt_touch_extension")) {
+        break;
+    case TouchExtensionInterface:
         mTouchExtension.reset(new QWaylandTouchExtension(this, id));
-    } else if (interface == QStringLiteral("qt_key_extension")) {
+        break;
+    case KeyExtensionInterface:
         mQtKeyExtension.reset(new QWaylandQtKeyExtension(this, id));
-    } else if (interface == QStringLiteral("zwp_text_input_manager_v2")) {
+        break;
+    case TextInputManagerInterface:
         mTextInputManager.reset(new QtWayland::zwp_text_input_manager_v2(registry, id, 1));
         foreach (QWaylandInputDevice *inputDevice, mInputDevices) {
             inputDevice->setTextInput(new QWaylandTextInput(this, mTextInputManager->get_text_input(inputDevice->wl_seat())));
         }
-    } else if (interface == QStringLiteral("qt_hardware_integration")) {
+        break;
+    case HardwareIntegrationInterface:
+        // The events sent by qt_hardware_integration are needed before creating
+        // windows, they are collected by the constructor's second roundtrip
         mHardwareIntegration.reset(new QWaylandHardwareIntegration(registry, id));
-        // make a roundtrip here since we need to receive the events sent by
-        // qt_hardware_integration before creating windows
-        forceRoundTrip();
+        break;
+    case UnknownInterface:
+        break;
     }
 
     mGlobals.append(RegistryGlobal(id, interface, version, registry));
@@ -302,6 +395,16 @@ void QWaylandDisplay::registry_global_remove(uint32_t id)
                         break;
                     }
                 }
+                for (int j = 0; j < mPendingScreens.size(); ++j) {
+                    QWaylandScreen *screen = mPendingScreens.at(j);
+                    if (screen->outputId() == id) {
+                        mPendingScreens.removeAt(j);
+                        if (j < mScreensCoveredBySync)
+                            --mScreensCoveredBySync;
+                        delete screen;
+                        break;
+                    }
+                }
             }
             mGlobals.removeAt(i);
             break;
@@ -435,8 +538,18 @@ void QWaylandDisplay::handleKeyboardFocusChanged(QWaylandInputDevice *inputDevic
     mLastKeyboardFocus = keyboardFocus;
 }
 
+void QWaylandDisplay::handleWindowCreated(QWaylandWindow *window)
+{
+    QMutexLocker locker(&mWindowsMutex);
+    mWindows.append(window);
+}
+
 void QWaylandDisplay::handleWindowDestroyed(QWaylandWindow *window)
 {
+    {
+        QMutexLocker locker(&mWindowsMutex);
+        mWindows.removeOne(window);
+    }
     if (mActiveWindows.contains(window))
         handleWindowDeactivated(window);
 }
@@ -470,6 +583,43 @@ void QWaylandDisplay::requestWaylandSync()
     wl_callback_add_listener(mSyncCallback, &syncCallbackListener, this);
 }
 
+const wl_callback_listener QWaylandDisplay::screensSyncCallbackListener = {
+    [](void *data, struct wl_callback *callback, uint32_t time){
+        Q_UNUSED(time);
+        wl_callback_destroy(callback);
+        QWaylandDisplay *display = static_cast<QWaylandDisplay *>(data);
+        display->mScreensSyncCallback = Q_NULLPTR;
+        display->initPendingScreens();
+        // Outputs bound while the sync was in flight need one of their own
+        display->requestScreensSync();
+    }
+};
+
+// Requested after binding outputs, so that a single sync covers the
+// initial events of all the outputs announced together
+void QWaylandDisplay::requestScreensSync()
+{
+    if (mScreensSyncCallback || mPendingScreens.isEmpty())
+        return;
+
+    mScreensCoveredBySync = mPendingScreens.size();
+    mScreensSyncCallback = wl_display_sync(mDisplay);
+    wl_callback_add_listener(mScreensSyncCallback, &screensSyncCallbackListener, this);
+}
+
+// Only the screens bound before the sync was sent have received all their events
+void QWaylandDisplay::initPendingScreens()
+{
+    const QList<QWaylandScreen *> screens = mPendingScreens.mid(0, mScreensCoveredBySync);
+    mPendingScreens = mPendingScreens.mid(mScreensCoveredBySync);
+    mScreensCoveredBySync = 0;
+    for (QWaylandScreen *screen : screens) {
+        mScreens.append(screen);
+        screen->init();
+        mWaylandIntegration->screenAdded(screen);
+    }
+}
+
 QWaylandInputDevice *QWaylandDisplay::defaultInputDevice() const
 {
     return mInputDevices.isEmpty() ? 0 : mInputDevices.first();
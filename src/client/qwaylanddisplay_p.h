@@ -55,6 +55,7 @@
 #include <QtCore/QRect>
 #include <QtCore/QPointer>
 #include <QtCore/QVector>
+#include <QtCore/QMutex>
 
 #include <QtCore/QWaitCondition>
 
@@ -119,6 +120,8 @@ public:
     QWaylandShellSurface *createShellSurface(QWaylandWindow *window);
     struct ::wl_region *createRegion(const QRegion &qregion);
     struct ::wl_subsurface *createSubSurface(QWaylandWindow *window, QWaylandWindow *parent);
+    struct ::wl_subsurface *createSubSurface(struct ::wl_surface *surface, struct ::wl_surface *parent);
+    bool hasSubCompositor() const { return !mSubCompositor.isNull(); }
 
     QWaylandClientBufferIntegration *clientBufferIntegration() const;
 
@@ -166,6 +169,10 @@ public:
 
     void forceRoundTrip();
 
+    void startEventThread();
+    bool hasEventThread() const { return !mEventThread.isNull(); }
+    void dispatchFrameCallbacks();
+
     bool supportsWindowDecoration() const;
 
     uint32_t lastInputSerial() const { return mLastInputSerial; }
@@ -176,12 +183,18 @@ public:
     void handleWindowActivated(QWaylandWindow *window);
     void handleWindowDeactivated(QWaylandWindow *window);
     void handleKeyboardFocusChanged(QWaylandInputDevice *inputDevice);
+    void handleWindowCreated(QWaylandWindow *window);
     void handleWindowDestroyed(QWaylandWindow *window);
 
+    void blockingReadEvents(struct ::wl_event_queue *queue);
+
 public slots:
     void blockingReadEvents();
     void flushRequests();
 
+private slots:
+    void requestScreensSync();
+
 private:
     void waitForScreens();
     void exitWithError();
@@ -189,6 +202,7 @@ private:
 
     void handleWaylandSync();
     void requestWaylandSync();
+    void initPendingScreens();
 
     struct Listener {
         RegistryListener listener;
@@ -199,6 +213,7 @@ private:
     QtWayland::wl_compositor mCompositor;
     QScopedPointer<QWaylandShm> mShm;
     QList<QWaylandScreen *> mScreens;
+    QList<QWaylandScreen *> mPendingScreens;
     QList<QWaylandInputDevice *> mInputDevices;
     QList<Listener> mRegistryListeners;
     QWaylandIntegration *mWaylandIntegration;
@@ -213,6 +228,7 @@ private:
     QScopedPointer<QtWayland::zwp_text_input_manager_v2> mTextInputManager;
     QScopedPointer<QWaylandHardwareIntegration> mHardwareIntegration;
     QSocketNotifier *mReadNotifier;
+    QScopedPointer<QWaylandEventThread> mEventThread;
     int mFd;
     int mWritableNotificationFd;
     QList<RegistryGlobal> mGlobals;
@@ -222,8 +238,13 @@ private:
     QPointer<QWaylandWindow> mLastInputWindow;
     QPointer<QWaylandWindow> mLastKeyboardFocus;
     QVector<QWaylandWindow *> mActiveWindows;
+    QVector<QWaylandWindow *> mWindows;
+    QMutex mWindowsMutex; // for mWindows, which the event thread reads too
     struct wl_callback *mSyncCallback;
     static const wl_callback_listener syncCallbackListener;
+    struct wl_callback *mScreensSyncCallback;
+    int mScreensCoveredBySync; // leading entries of mPendingScreens the sync was requested for
+    static const wl_callback_listener screensSyncCallbackListener;
 
     void registry_global(uint32_t id, const QString &interface, uint32_t version) override;
     void registry_global_remove(uint32_t id) override;
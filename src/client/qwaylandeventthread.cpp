@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwaylandeventthread_p.h"
+#include "qwaylanddisplay_p.h"
+
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <wayland-client.h>
+
+#include <poll.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWaylandClient {
+
+QWaylandEventThread::QWaylandEventThread(QWaylandDisplay *display)
+    : m_display(display)
+    , m_wlDisplay(display->wl_display())
+    // Nothing is ever put on this queue, it only exists so that preparing to
+    // read doesn't depend on the main thread having dispatched the default one.
+    , m_queue(wl_display_create_queue(m_wlDisplay))
+{
+    if (qt_safe_pipe(m_wakeFds) != 0)
+        qErrnoWarning(errno, "Failed to create the Wayland event thread pipe");
+    setObjectName(QStringLiteral("QWaylandEventThread"));
+}
+
+QWaylandEventThread::~QWaylandEventThread()
+{
+    stop();
+    wl_event_queue_destroy(m_queue);
+    qt_safe_close(m_wakeFds[0]);
+    qt_safe_close(m_wakeFds[1]);
+}
+
+void QWaylandEventThread::stop()
+{
+    if (!isRunning())
+        return;
+    const char c = 0;
+    qt_safe_write(m_wakeFds[1], &c, 1);
+    wait();
+}
+
+void QWaylandEventThread::run()
+{
+    struct pollfd fds[2] = {
+        { wl_display_get_fd(m_wlDisplay), POLLIN, 0 },
+        { m_wakeFds[0], POLLIN, 0 }
+    };
+
+    forever {
+        while (wl_display_prepare_read_queue(m_wlDisplay, m_queue) != 0)
+            wl_display_dispatch_queue_pending(m_wlDisplay, m_queue);
+
+        fds[0].revents = fds[1].revents = 0;
+        if (::poll(fds, 2, -1) < 0) {
+            wl_display_cancel_read(m_wlDisplay);
+            if (errno == EINTR)
+                continue;
+            qErrnoWarning(errno, "Polling the Wayland connection failed");
+            return;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            wl_display_cancel_read(m_wlDisplay);
+            return;
+        }
+
+        const bool failed = wl_display_read_events(m_wlDisplay) < 0;
+
+        // Frame callbacks only touch thread-safe window state, so they are
+        // dispatched right here. Everything else is left to the main thread.
+        if (!failed)
+            m_display->dispatchFrameCallbacks();
+
+        // Let the main thread dispatch the default queue, or report the error.
+        if (m_dispatchPending.testAndSetRelaxed(0, 1))
+            QMetaObject::invokeMethod(m_display, "flushRequests", Qt::QueuedConnection);
+
+        if (failed)
+            return;
+    }
+}
+
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,98 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWAYLANDEVENTTHREAD_H
+#define QWAYLANDEVENTTHREAD_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QThread>
+#include <QtCore/QAtomicInt>
+
+#include <QtWaylandClient/qtwaylandclientglobal.h>
+
+struct wl_display;
+struct wl_event_queue;
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWaylandClient {
+
+class QWaylandDisplay;
+
+// Reads events from the display connection independently of the main thread,
+// so that threads waiting on their own event queues (e.g. for frame callbacks)
+// keep getting events while the main thread is busy. It also dispatches the
+// windows' frame callback queues. Events for the default queue, including the
+// release of shm buffers, are still dispatched by the main thread.
+class Q_WAYLAND_CLIENT_EXPORT QWaylandEventThread : public QThread
+{
+    Q_OBJECT
+public:
+    QWaylandEventThread(QWaylandDisplay *display);
+    ~QWaylandEventThread();
+
+    void stop();
+    void eventsDispatched() { m_dispatchPending.store(0); }
+
+protected:
+    void run() override;
+
+private:
+    QWaylandDisplay *m_display;
+    struct ::wl_display *m_wlDisplay;
+    struct ::wl_event_queue *m_queue;
+    int m_wakeFds[2];
+    QAtomicInt m_dispatchPending;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QWAYLANDEVENTTHREAD_H
@@ -54,6 +54,9 @@
 #include "../shared/qwaylandxkb_p.h"
 #include "qwaylandinputcontext_p.h"
 
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QHash>
+#include <QtCore/private/qcore_unix_p.h>
 #include <QtGui/private/qpixmap_raster_p.h>
 #include <QtGui/private/qguiapplication_p.h>
 #include <qpa/qplatformwindow.h>
@@ -63,6 +66,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #if QT_CONFIG(cursor)
 #include <wayland-cursor.h>
@@ -88,6 +92,139 @@ QWaylandInputDevice::Keyboard::Keyboard(QWaylandInputDevice *p)
 }
 
 #if QT_CONFIG(xkbcommon_evdev)
+// Compiled keymaps shared by the keyboards of all input devices. Compositors
+// usually send the same keymap to every seat and resend it on focus changes,
+// so keymaps are looked up by content before compiling them again. A keymap
+// sent in a sealed file is immutable, which lets us recognize it by the file
+// alone without mapping and hashing it; we keep such files open so their
+// inode cannot be reused while the keymap is cached.
+class QWaylandKeymapCache
+{
+public:
+    QWaylandKeymapCache();
+    ~QWaylandKeymapCache();
+
+    xkb_context *context() const { return m_context; }
+    xkb_keymap *keymapFromNames(const xkb_rule_names &names);
+    xkb_keymap *keymapFromFile(int fd, uint32_t size);
+
+private:
+    enum { MaxKeymaps = 4 };
+
+    struct Entry {
+        xkb_keymap *keymap;
+        int fd;
+    };
+
+    xkb_keymap *find(const QByteArray &key);
+    void insert(const QByteArray &key, xkb_keymap *keymap, int fd = -1);
+
+    xkb_context *m_context;
+    QHash<QByteArray, Entry> m_keymaps;
+    QList<QByteArray> m_recent;
+};
+
+Q_GLOBAL_STATIC(QWaylandKeymapCache, keymapCache)
+
+QWaylandKeymapCache::QWaylandKeymapCache()
+    : m_context(xkb_context_new(xkb_context_flags(0)))
+{
+}
+
+QWaylandKeymapCache::~QWaylandKeymapCache()
+{
+    for (const Entry &entry : qAsConst(m_keymaps)) {
+        xkb_keymap_unref(entry.keymap);
+        if (entry.fd >= 0)
+            close(entry.fd);
+    }
+    if (m_context)
+        xkb_context_unref(m_context);
+}
+
+// Returns a new reference to the cached keymap, or 0
+xkb_keymap *QWaylandKeymapCache::find(const QByteArray &key)
+{
+    auto it = m_keymaps.constFind(key);
+    if (it == m_keymaps.constEnd())
+        return 0;
+
+    m_recent.removeOne(key);
+    m_recent.append(key);
+    return xkb_keymap_ref(it->keymap);
+}
+
+// Takes over the reference to keymap and the ownership of fd
+void QWaylandKeymapCache::insert(const QByteArray &key, xkb_keymap *keymap, int fd)
+{
+    m_keymaps.insert(key, Entry{keymap, fd});
+    m_recent.append(key);
+    while (m_recent.size() > MaxKeymaps) {
+        const Entry entry = m_keymaps.take(m_recent.takeFirst());
+        xkb_keymap_unref(entry.keymap);
+        if (entry.fd >= 0)
+            close(entry.fd);
+    }
+}
+
+xkb_keymap *QWaylandKeymapCache::keymapFromNames(const xkb_rule_names &names)
+{
+    if (!m_context)
+        return 0;
+
+    const QByteArray key = QByteArray("names:") + names.rules + '\0' + names.model + '\0'
+            + names.layout + '\0' + names.variant + '\0' + names.options;
+    if (xkb_keymap *keymap = find(key))
+        return keymap;
+
+    xkb_keymap *keymap = xkb_keymap_new_from_names(m_context, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (keymap)
+        insert(key, xkb_keymap_ref(keymap));
+    return keymap;
+}
+
+xkb_keymap *QWaylandKeymapCache::keymapFromFile(int fd, uint32_t size)
+{
+    if (!m_context)
+        return 0;
+
+    QByteArray fileKey;
+#if defined(F_GET_SEALS) && defined(F_SEAL_WRITE)
+    struct stat st;
+    const int seals = fcntl(fd, F_GET_SEALS);
+    if (seals >= 0 && (seals & F_SEAL_WRITE) && (seals & F_SEAL_SHRINK) && fstat(fd, &st) == 0) {
+        fileKey = "file:" + QByteArray::number(quint64(st.st_dev)) + ':'
+                + QByteArray::number(quint64(st.st_ino)) + ':' + QByteArray::number(size);
+        if (xkb_keymap *keymap = find(fileKey))
+            return keymap;
+    }
+#endif
+
+    char *map_str = static_cast<char *>(mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0));
+    if (map_str == MAP_FAILED)
+        return 0;
+
+    // The keymap string is null-terminated, don't hash the terminator
+    const int length = qstrnlen(map_str, size);
+    const QByteArray contentKey = "sha1:" + QCryptographicHash::hash(QByteArray::fromRawData(map_str, length),
+                                                                     QCryptographicHash::Sha1);
+    xkb_keymap *keymap = find(contentKey);
+    if (!keymap) {
+        keymap = xkb_keymap_new_from_buffer(m_context, map_str, length, XKB_KEYMAP_FORMAT_TEXT_V1,
+                                            XKB_KEYMAP_COMPILE_NO_FLAGS);
+        if (keymap)
+            insert(contentKey, xkb_keymap_ref(keymap));
+    }
+    munmap(map_str, size);
+
+    if (keymap && !fileKey.isEmpty()) {
+        int cachedFd = qt_safe_dup(fd);
+        if (cachedFd >= 0)
+            insert(fileKey, xkb_keymap_ref(keymap), cachedFd);
+    }
+    return keymap;
+}
+
 bool QWaylandInputDevice::Keyboard::createDefaultKeyMap()
 {
     if (mXkbContext && mXkbMap && mXkbState) {
@@ -95,15 +232,16 @@ bool QWaylandInputDevice::Keyboard::createDefaultKeyMap()
     }
 
     xkb_rule_names names;
-    names.rules = strdup("evdev");
-    names.model = strdup("pc105");
-    names.layout = strdup("us");
-    names.variant = strdup("");
-    names.options = strdup("");
+    names.rules = "evdev";
+    names.model = "pc105";
+    names.layout = "us";
+    names.variant = "";
+    names.options = "";
 
-    mXkbContext = xkb_context_new(xkb_context_flags(0));
+    mXkbContext = keymapCache()->context();
     if (mXkbContext) {
-        mXkbMap = xkb_map_new_from_names(mXkbContext, &names, xkb_map_compile_flags(0));
+        xkb_context_ref(mXkbContext);
+        mXkbMap = keymapCache()->keymapFromNames(names);
         if (mXkbMap) {
             mXkbState = xkb_state_new(mXkbMap);
         }
@@ -124,6 +262,9 @@ void QWaylandInputDevice::Keyboard::releaseKeyMap()
         xkb_map_unref(mXkbMap);
     if (mXkbContext)
         xkb_context_unref(mXkbContext);
+    mXkbState = 0;
+    mXkbMap = 0;
+    mXkbContext = 0;
 }
 #endif
 
@@ -450,7 +591,9 @@ void QWaylandInputDevice::Pointer::pointer_enter(uint32_t serial, struct wl_surf
 #endif
 
     mFocus = window;
-    mSurfacePos = QPointF(wl_fixed_to_double(sx), wl_fixed_to_double(sy));
+    // The surface may be one of the window's decoration subsurfaces
+    mSurfaceOffset = window->mapFromWlSurface(surface, QPointF());
+    mSurfacePos = QPointF(wl_fixed_to_double(sx), wl_fixed_to_double(sy)) + mSurfaceOffset;
     mGlobalPos = window->window()->mapToGlobal(mSurfacePos.toPoint());
 
     mParent->mSerial = serial;
@@ -499,7 +642,7 @@ void QWaylandInputDevice::Pointer::pointer_motion(uint32_t time, wl_fixed_t surf
         return;
     }
 
-    QPointF pos(wl_fixed_to_double(surface_x), wl_fixed_to_double(surface_y));
+    QPointF pos = QPointF(wl_fixed_to_double(surface_x), wl_fixed_to_double(surface_y)) + mSurfaceOffset;
     QPointF delta = pos - pos.toPoint();
     QPointF global = window->window()->mapToGlobal(pos.toPoint());
     global += delta;
@@ -624,9 +767,15 @@ void QWaylandInputDevice::Keyboard::keyboard_keymap(uint32_t format, int32_t fd,
         return;
     }
 
-    char *map_str = (char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
-    if (map_str == MAP_FAILED) {
-        close(fd);
+    xkb_keymap *keymap = keymapCache()->keymapFromFile(fd, size);
+    close(fd);
+    if (!keymap)
+        return;
+
+    // A compositor resending the keymap we already use, e.g. on focus
+    // changes, doesn't invalidate the current state
+    if (keymap == mXkbMap && mXkbState) {
+        xkb_keymap_unref(keymap);
         return;
     }
 
@@ -634,11 +783,8 @@ void QWaylandInputDevice::Keyboard::keyboard_keymap(uint32_t format, int32_t fd,
     // the key event or when the compositor issues a new map
     releaseKeyMap();
 
-    mXkbContext = xkb_context_new(xkb_context_flags(0));
-    mXkbMap = xkb_map_new_from_string(mXkbContext, map_str, XKB_KEYMAP_FORMAT_TEXT_V1, (xkb_keymap_compile_flags)0);
-    munmap(map_str, size);
-    close(fd);
-
+    mXkbContext = xkb_context_ref(keymapCache()->context());
+    mXkbMap = keymap;
     mXkbState = xkb_state_new(mXkbMap);
 #else
     Q_UNUSED(format);
@@ -809,8 +955,9 @@ void QWaylandInputDevice::Touch::touch_down(uint32_t serial,
     mParent->mTime = time;
     mParent->mSerial = serial;
     mFocus = QWaylandWindow::fromWlSurface(surface);
+    mSurfaceOffset = mFocus->mapFromWlSurface(surface, QPointF());
     mParent->mQDisplay->setLastInputDevice(mParent, serial, mFocus);
-    mParent->handleTouchPoint(id, wl_fixed_to_double(x), wl_fixed_to_double(y), Qt::TouchPointPressed);
+    mParent->handleTouchPoint(id, wl_fixed_to_double(x) + mSurfaceOffset.x(), wl_fixed_to_double(y) + mSurfaceOffset.y(), Qt::TouchPointPressed);
 }
 
 void QWaylandInputDevice::Touch::touch_up(uint32_t serial, uint32_t time, int32_t id)
@@ -831,7 +978,7 @@ void QWaylandInputDevice::Touch::touch_up(uint32_t serial, uint32_t time, int32_
 void QWaylandInputDevice::Touch::touch_motion(uint32_t time, int32_t id, wl_fixed_t x, wl_fixed_t y)
 {
     Q_UNUSED(time);
-    mParent->handleTouchPoint(id, wl_fixed_to_double(x), wl_fixed_to_double(y), Qt::TouchPointMoved);
+    mParent->handleTouchPoint(id, wl_fixed_to_double(x) + mSurfaceOffset.x(), wl_fixed_to_double(y) + mSurfaceOffset.y(), Qt::TouchPointMoved);
 }
 
 void QWaylandInputDevice::Touch::touch_cancel()
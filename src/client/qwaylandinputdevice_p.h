@@ -259,6 +259,7 @@ public:
     uint32_t mCursorSerial;
 #endif
     QPointF mSurfacePos;
+    QPointF mSurfaceOffset;
     QPointF mGlobalPos;
     Qt::MouseButtons mButtons;
 #if QT_CONFIG(cursor)
@@ -294,6 +295,7 @@ public:
 
     QWaylandInputDevice *mParent;
     QWaylandWindow *mFocus;
+    QPointF mSurfaceOffset;
     QList<QWindowSystemInterface::TouchPoint> mTouchPoints;
     QList<QWindowSystemInterface::TouchPoint> mPrevTouchPoints;
 };
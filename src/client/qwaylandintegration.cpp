@@ -218,9 +218,15 @@ void QWaylandIntegration::initialize()
     QObject::connect(dispatcher, SIGNAL(aboutToBlock()), mDisplay.data(), SLOT(flushRequests()));
     QObject::connect(dispatcher, SIGNAL(awake()), mDisplay.data(), SLOT(flushRequests()));
 
-    int fd = wl_display_get_fd(mDisplay->wl_display());
-    QSocketNotifier *sn = new QSocketNotifier(fd, QSocketNotifier::Read, mDisplay.data());
-    QObject::connect(sn, SIGNAL(activated(int)), mDisplay.data(), SLOT(flushRequests()));
+    if (qEnvironmentVariableIsSet("QT_WAYLAND_EVENT_THREAD")) {
+        // Keep reading events while the main thread is busy, so that rendering
+        // threads waiting for frame callbacks don't depend on it.
+        mDisplay->startEventThread();
+    } else {
+        int fd = wl_display_get_fd(mDisplay->wl_display());
+        QSocketNotifier *sn = new QSocketNotifier(fd, QSocketNotifier::Read, mDisplay.data());
+        QObject::connect(sn, SIGNAL(activated(int)), mDisplay.data(), SLOT(flushRequests()));
+    }
 
     if (mDisplay->screens().isEmpty()) {
         qWarning() << "Running on a compositor with no screens is not supported";
@@ -173,6 +173,10 @@ QFunctionPointer QWaylandNativeInterface::platformFunction(const QByteArray &res
         return QFunctionPointer(setDeSync);
     } else if (resource == QWaylandWindowFunctions::isSyncIdentifier()) {
         return QFunctionPointer(isSync);
+    } else if (resource == QByteArrayLiteral("WaylandWindowFunctionsSetSwapDamage")) {
+        return QFunctionPointer(setSwapDamage);
+    } else if (resource == QByteArrayLiteral("WaylandWindowFunctionsBufferAge")) {
+        return QFunctionPointer(bufferAge);
     }
     return nullptr;
 }
@@ -203,6 +207,23 @@ bool QWaylandNativeInterface::isSync(QWindow *window)
     return false;
 }
 
+// Damage for the next swap of an OpenGL window, passed on with
+// eglSwapBuffersWithDamage when the EGL implementation supports it
+void QWaylandNativeInterface::setSwapDamage(QWindow *window, const QRegion &damage)
+{
+    QWaylandWindow *ww = static_cast<QWaylandWindow*>(window->handle());
+    if (ww)
+        ww->setSwapDamage(damage);
+}
+
+// Age of the back buffer as of EGL_EXT_buffer_age, 0 when the content is undefined.
+// Must be called with the window's context current.
+int QWaylandNativeInterface::bufferAge(QWindow *window)
+{
+    QWaylandWindow *ww = static_cast<QWaylandWindow*>(window->handle());
+    return ww ? ww->bufferAge() : 0;
+}
+
 }
 
 QT_END_NAMESPACE
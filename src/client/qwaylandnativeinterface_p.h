@@ -91,6 +91,8 @@ private:
     static void setSync(QWindow *window);
     static void setDeSync(QWindow *window);
     static bool isSync(QWindow *window);
+    static void setSwapDamage(QWindow *window, const QRegion &damage);
+    static int bufferAge(QWindow *window);
 };
 
 }
@@ -55,6 +55,13 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/mman.h>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
 
 QT_BEGIN_NAMESPACE
 
@@ -64,32 +71,30 @@ Q_DECLARE_LOGGING_CATEGORY(logCategory)
 
 Q_LOGGING_CATEGORY(logCategory, "qt.qpa.wayland.backingstore")
 
+static const int shmPoolAlignment = 64;
+
+static int alignedSize(int size, int alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
 QWaylandShmBuffer::QWaylandShmBuffer(QWaylandDisplay *display,
                      const QSize &size, QImage::Format format, int scale)
     : QWaylandBuffer()
     , mShmPool(0)
+    , mPool(0)
+    , mOffset(0)
+    , mAllocSize(0)
     , mMarginsImage(0)
 {
     int stride = size.width() * 4;
     int alloc = stride * size.height();
-    char filename[] = "/tmp/wayland-shm-XXXXXX";
-    int fd = mkstemp(filename);
-    if (fd < 0) {
-        qWarning("mkstemp %s failed: %s", filename, strerror(errno));
+    int fd = QWaylandShmPool::createAnonymousFile(alloc);
+    if (fd < 0)
         return;
-    }
-    int flags = fcntl(fd, F_GETFD);
-    if (flags != -1)
-        fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
 
-    if (ftruncate(fd, alloc) < 0) {
-        qWarning("ftruncate failed: %s", strerror(errno));
-        close(fd);
-        return;
-    }
     uchar *data = (uchar *)
             mmap(NULL, alloc, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    unlink(filename);
 
     if (data == (uchar *) MAP_FAILED) {
         qWarning("mmap /dev/zero failed: %s", strerror(errno));
@@ -101,6 +106,7 @@ QWaylandShmBuffer::QWaylandShmBuffer(QWaylandDisplay *display,
     wl_shm_format wl_format = shm->formatFrom(format);
     mImage = QImage(data, size.width(), size.height(), stride, format);
     mImage.setDevicePixelRatio(qreal(scale));
+    mAllocSize = alloc;
 
     mShmPool = wl_shm_create_pool(shm->object(), fd, alloc);
     init(wl_shm_pool_create_buffer(mShmPool,0, size.width(), size.height(),
@@ -108,15 +114,59 @@ QWaylandShmBuffer::QWaylandShmBuffer(QWaylandDisplay *display,
     close(fd);
 }
 
+QWaylandShmBuffer::QWaylandShmBuffer(QWaylandShmPool *pool,
+                     const QSize &size, QImage::Format format, int scale)
+    : QWaylandBuffer()
+    , mShmPool(0)
+    , mPool(0)
+    , mOffset(0)
+    , mAllocSize(0)
+    , mMarginsImage(0)
+{
+    int stride = size.width() * 4;
+    int alloc = alignedSize(stride * size.height(), shmPoolAlignment);
+    if (!pool->allocate(alloc, &mOffset))
+        return;
+
+    mPool = pool;
+    mAllocSize = alloc;
+    mPool->mBuffers.append(this);
+
+    QWaylandShm* shm = pool->display()->shm();
+    wl_shm_format wl_format = shm->formatFrom(format);
+    mImage = QImage(pool->data() + mOffset, size.width(), size.height(), stride, format);
+    mImage.setDevicePixelRatio(qreal(scale));
+    mDirtyRegion = mImage.rect();
+
+    init(wl_shm_pool_create_buffer(pool->object(), mOffset, size.width(), size.height(),
+                                       stride, wl_format));
+}
+
 QWaylandShmBuffer::~QWaylandShmBuffer(void)
 {
     delete mMarginsImage;
-    if (mImage.constBits())
-        munmap((void *) mImage.constBits(), mImage.byteCount());
+    if (mPool) {
+        mPool->mBuffers.removeOne(this);
+        mPool->release(mOffset, mAllocSize);
+    } else if (mImage.constBits()) {
+        munmap((void *) mImage.constBits(), mAllocSize);
+    }
     if (mShmPool)
         wl_shm_pool_destroy(mShmPool);
 }
 
+// Called by the pool when it had to move its mapping to grow.
+void QWaylandShmBuffer::setData(uchar *data)
+{
+    QImage image(data, mImage.width(), mImage.height(), mImage.bytesPerLine(), mImage.format());
+    image.setDevicePixelRatio(mImage.devicePixelRatio());
+    mImage = image;
+
+    delete mMarginsImage;
+    mMarginsImage = 0;
+    mMargins = QMargins();
+}
+
 QImage *QWaylandShmBuffer::imageInsideMargins(const QMargins &marginsIn)
 {
     QMargins margins = marginsIn * int(mImage.devicePixelRatio());
@@ -145,14 +195,203 @@ QImage *QWaylandShmBuffer::imageInsideMargins(const QMargins &marginsIn)
 
 }
 
+QWaylandShmPool::QWaylandShmPool(QWaylandDisplay *display)
+    : mDisplay(display)
+    , mShmPool(0)
+    , mFd(-1)
+    , mData(0)
+    , mSize(0)
+{
+}
+
+QWaylandShmPool::~QWaylandShmPool()
+{
+    Q_ASSERT(mBuffers.isEmpty());
+    reset();
+}
+
+int QWaylandShmPool::createAnonymousFile(int size)
+{
+    int fd = -1;
+#if defined(Q_OS_LINUX) && defined(SYS_memfd_create)
+    fd = syscall(SYS_memfd_create, "wayland-shm", MFD_CLOEXEC);
+#endif
+    if (fd < 0) {
+        char filename[] = "/tmp/wayland-shm-XXXXXX";
+        fd = mkstemp(filename);
+        if (fd < 0) {
+            qWarning("mkstemp %s failed: %s", filename, strerror(errno));
+            return -1;
+        }
+        unlink(filename);
+        int flags = fcntl(fd, F_GETFD);
+        if (flags != -1)
+            fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        qWarning("ftruncate failed: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool QWaylandShmPool::allocate(int size, int *offset)
+{
+    // Start over with a pool fitting the request if nothing lives in the
+    // current one anymore and it is much bigger than what we need, e.g.
+    // after a maximized window got restored.
+    if (mBuffers.isEmpty() && mSize > 2 * size)
+        reset();
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it) {
+            if (it.value() < size)
+                continue;
+            *offset = it.key();
+            const int remaining = it.value() - size;
+            mFreeRanges.erase(it);
+            if (remaining > 0)
+                mFreeRanges.insert(*offset + size, remaining);
+            return true;
+        }
+        if (pass == 0 && !grow(size))
+            return false;
+    }
+    return false;
+}
+
+void QWaylandShmPool::release(int offset, int size)
+{
+    auto next = mFreeRanges.lowerBound(offset);
+    if (next != mFreeRanges.end() && offset + size == next.key()) {
+        size += next.value();
+        next = mFreeRanges.erase(next);
+    }
+    if (next != mFreeRanges.begin()) {
+        auto previous = next - 1;
+        if (previous.key() + previous.value() == offset) {
+            previous.value() += size;
+            return;
+        }
+    }
+    mFreeRanges.insert(offset, size);
+}
+
+bool QWaylandShmPool::grow(int size)
+{
+    // Only grow by what the free range at the end of the pool can't provide
+    int tailFree = 0;
+    if (!mFreeRanges.isEmpty()) {
+        auto last = mFreeRanges.end() - 1;
+        if (last.key() + last.value() == mSize)
+            tailFree = last.value();
+    }
+
+    const int pageSize = int(sysconf(_SC_PAGESIZE));
+    int newSize = qMax(mSize + size - tailFree, mSize + mSize / 2);
+    newSize = alignedSize(newSize, pageSize);
+
+    if (mFd < 0) {
+        mFd = createAnonymousFile(newSize);
+        if (mFd < 0)
+            return false;
+    } else if (ftruncate(mFd, newSize) < 0) {
+        qWarning("ftruncate failed: %s", strerror(errno));
+        return false;
+    }
+
+    uchar *data = (uchar *) mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (data == (uchar *) MAP_FAILED) {
+        qWarning("mmap failed: %s", strerror(errno));
+        return false;
+    }
+
+    if (mData) {
+        munmap(mData, mSize);
+        for (QWaylandShmBuffer *buffer : qAsConst(mBuffers))
+            buffer->setData(data + buffer->mOffset);
+    }
+
+    if (mShmPool)
+        wl_shm_pool_resize(mShmPool, newSize);
+    else
+        mShmPool = wl_shm_create_pool(mDisplay->shm()->object(), mFd, newSize);
+
+    release(mSize, newSize - mSize);
+    mData = data;
+    mSize = newSize;
+    return true;
+}
+
+void QWaylandShmPool::reset()
+{
+    if (mShmPool)
+        wl_shm_pool_destroy(mShmPool);
+    if (mData)
+        munmap(mData, mSize);
+    if (mFd >= 0)
+        close(mFd);
+
+    mShmPool = 0;
+    mData = 0;
+    mFd = -1;
+    mSize = 0;
+    mFreeRanges.clear();
+}
+
+// Double buffering is enough when the compositor releases buffers before the
+// next frame, more only pays off while it holds on to them for longer.
+static const int MinBuffers = 2;
+static const int MaxBuffers = 5;
+
+// Frame callbacks may be withheld or throttled while the window is hidden, so
+// a commit never waits for one longer than this (in ms).
+static const int MaxCommitDeferral = 100;
+
+static void copyRegion(QImage *dst, const QImage &src, const QRegion &region)
+{
+    const int bytesPerPixel = src.depth() / 8;
+    const int bytesPerLine = src.bytesPerLine();
+    uchar *dstBits = dst->bits();
+    const uchar *srcBits = src.constBits();
+
+    for (const QRect &rect : region.intersected(src.rect())) {
+        const int offset = rect.top() * bytesPerLine + rect.left() * bytesPerPixel;
+        if (rect.width() == src.width()) {
+            memcpy(dstBits + offset, srcBits + offset, rect.height() * bytesPerLine);
+            continue;
+        }
+        const int length = rect.width() * bytesPerPixel;
+        for (int y = 0; y < rect.height(); ++y)
+            memcpy(dstBits + offset + y * bytesPerLine, srcBits + offset + y * bytesPerLine, length);
+    }
+}
+
 QWaylandShmBackingStore::QWaylandShmBackingStore(QWindow *window)
     : QPlatformBackingStore(window)
     , mDisplay(QWaylandScreen::waylandScreenFromWindow(window)->display())
+    , mPool(mDisplay)
     , mFrontBuffer(0)
     , mBackBuffer(0)
     , mPainting(false)
+    , mCommitDeferred(false)
+    , mBufferLimit(MinBuffers)
+    , mFrameInterval(0)
+    , mReleaseLatency(0)
+    , mFrameCount(0)
+    , mStallCount(0)
+    , mStallTime(0)
+    , mDecorationsDirty(true)
 {
-
+    mCommitTimer.setSingleShot(true);
+    mCommitTimer.setInterval(MaxCommitDeferral);
+    QObject::connect(&mCommitTimer, &QTimer::timeout, [this]() {
+        if (mCommitDeferred && !mPainting && mBackBuffer)
+            commit(QRegion());
+    });
 }
 
 QWaylandShmBackingStore::~QWaylandShmBackingStore()
@@ -178,6 +417,9 @@ void QWaylandShmBackingStore::beginPaint(const QRegion &region)
 
     waylandWindow()->setCanResize(false);
 
+    QMargins margins = windowDecorationMargins();
+    markDirty(region.translated(margins.left(), margins.top()));
+
     if (mBackBuffer->image()->hasAlphaChannel()) {
         QPainter p(paintDevice());
         p.setCompositionMode(QPainter::CompositionMode_Source);
@@ -212,14 +454,63 @@ void QWaylandShmBackingStore::flush(QWindow *window, const QRegion &region, cons
     Q_UNUSED(window);
     Q_UNUSED(offset);
 
-    if (windowDecoration() && windowDecoration()->isDirty())
+    if (windowDecoration() && (mDecorationsDirty || windowDecoration()->isDirty()))
         updateDecorations();
 
-    mFrontBuffer = mBackBuffer;
-
     QMargins margins = windowDecorationMargins();
+    const QRegion damage = region.translated(margins.left(), margins.top());
+
+    // While the compositor hasn't shown the previous frame yet, keep painting
+    // into the same back buffer and commit it once the frame callback arrives,
+    // instead of tying up another buffer for a frame that would never be seen.
+    if (shouldDeferCommit()) {
+        if (!mCommitDeferred) {
+            mDeferralTimer.start();
+            mCommitTimer.start();
+        }
+        mDeferredDamage += damage;
+        mCommitDeferred = true;
+        return;
+    }
+
+    commit(damage);
+}
 
-    waylandWindow()->commit(mFrontBuffer, region.translated(margins.left(), margins.top()));
+// A new buffer size and the answer to a configure have to reach the
+// compositor right away, everything else may wait a bit for the frame callback.
+bool QWaylandShmBackingStore::shouldDeferCommit() const
+{
+    QWaylandWindow *window = waylandWindow();
+    if (!window->isWaitingForFrameSync() || window->hasPendingConfigure())
+        return false;
+    if (!mFrontBuffer || !mBackBuffer || mFrontBuffer->size() != mBackBuffer->size())
+        return false;
+    return !mCommitDeferred || mDeferralTimer.elapsed() < MaxCommitDeferral;
+}
+
+void QWaylandShmBackingStore::commitDeferred()
+{
+    if (!mCommitDeferred || mPainting || !mBackBuffer || waylandWindow()->isWaitingForFrameSync())
+        return;
+    commit(QRegion());
+}
+
+void QWaylandShmBackingStore::commit(const QRegion &damage)
+{
+    const QRegion allDamage = mDeferredDamage + damage;
+    mDeferredDamage = QRegion();
+    mCommitDeferred = false;
+    mCommitTimer.stop();
+
+    if (mFrameTimer.isValid()) {
+        const qint64 interval = mFrameTimer.restart();
+        mFrameInterval = mFrameInterval ? (3 * mFrameInterval + interval) / 4 : interval;
+    } else {
+        mFrameTimer.start();
+    }
+
+    mFrontBuffer = mBackBuffer;
+    waylandWindow()->commit(mFrontBuffer, allDamage);
 }
 
 void QWaylandShmBackingStore::resize(const QSize &size, const QRegion &)
@@ -227,31 +518,53 @@ void QWaylandShmBackingStore::resize(const QSize &size, const QRegion &)
     mRequestedSize = size;
 }
 
-QWaylandShmBuffer *QWaylandShmBackingStore::getBuffer(const QSize &size)
+// Returns a free buffer of the given size, allocating one if there are fewer
+// than limit buffers. Free buffers that are not needed anymore are dropped.
+QWaylandShmBuffer *QWaylandShmBackingStore::getBuffer(const QSize &size, int limit)
 {
+    QWaylandShmBuffer *found = nullptr;
     foreach (QWaylandShmBuffer *b, mBuffers) {
         if (!b->busy()) {
-            if (b->size() == size) {
-                return b;
-            } else {
+            if (!found && b->size() == size) {
+                found = b;
+            } else if (b->size() != size || mBuffers.count() > mBufferLimit) {
                 mBuffers.removeOne(b);
                 if (mBackBuffer == b)
                     mBackBuffer = 0;
+                if (mFrontBuffer == b)
+                    mFrontBuffer = 0;
                 delete b;
             }
         }
     }
+    if (found)
+        return found;
 
-    static const int MAX_BUFFERS = 5;
-    if (mBuffers.count() < MAX_BUFFERS) {
+    if (mBuffers.count() < limit) {
         QImage::Format format = QPlatformScreen::platformScreenForWindow(window())->format();
-        QWaylandShmBuffer *b = new QWaylandShmBuffer(mDisplay, size, format, waylandWindow()->scale());
+        QWaylandShmBuffer *b = new QWaylandShmBuffer(&mPool, size, format, waylandWindow()->scale());
         mBuffers.prepend(b);
         return b;
     }
     return 0;
 }
 
+// Adapts the number of buffers to how long the compositor holds on to them
+// compared to how often we commit.
+void QWaylandShmBackingStore::updateBufferLimit()
+{
+    for (QWaylandShmBuffer *b : qAsConst(mBuffers)) {
+        const qint64 latency = b->takeReleaseLatency();
+        if (latency >= 0)
+            mReleaseLatency = (3 * mReleaseLatency + latency) / 4;
+    }
+
+    int wanted = MinBuffers;
+    if (mFrameInterval > 0)
+        wanted += int(mReleaseLatency / mFrameInterval);
+    mBufferLimit = qBound(MinBuffers, wanted, MaxBuffers);
+}
+
 void QWaylandShmBackingStore::resize(const QSize &size)
 {
     QMargins margins = windowDecorationMargins();
@@ -259,36 +572,55 @@ void QWaylandShmBackingStore::resize(const QSize &size)
     QSize sizeWithMargins = (size + QSize(margins.left()+margins.right(),margins.top()+margins.bottom())) * scale;
 
     // We look for a free buffer to draw into. If the buffer is not the last buffer we used,
-    // that is mBackBuffer, and the size is the same we memcpy the old content into the new
-    // buffer so that QPainter is happy to find the stuff it had drawn before. If the new
-    // buffer has a different size it needs to be redrawn completely anyway, and if the buffer
-    // is the same the stuff is there already.
+    // that is mBackBuffer, and the size is the same we copy the parts of the old content that
+    // were painted since the new buffer was last used, so that QPainter is happy to find the
+    // stuff it had drawn before. If the new buffer has a different size it needs to be redrawn
+    // completely anyway, and if the buffer is the same the stuff is there already.
     // You can exercise the different codepaths with weston, switching between the gl and the
     // pixman renderer. With the gl renderer release events are sent early so we can effectively
     // run single buffered, while with the pixman renderer we have to use two.
-    QWaylandShmBuffer *buffer = getBuffer(sizeWithMargins);
-    while (!buffer) {
-        qCDebug(logCategory, "QWaylandShmBackingStore: stalling waiting for a buffer to be released from the compositor...");
-
-        mDisplay->blockingReadEvents();
-        buffer = getBuffer(sizeWithMargins);
+    updateBufferLimit();
+    ++mFrameCount;
+    QWaylandShmBuffer *buffer = getBuffer(sizeWithMargins, mBufferLimit);
+    if (!buffer) {
+        // Releases may have been received already without being dispatched.
+        mDisplay->flushRequests();
+        buffer = getBuffer(sizeWithMargins, mBufferLimit);
+    }
+    if (!buffer) {
+        // Rather allocate another buffer than block, the limit brings the
+        // count back down once the compositor keeps up again.
+        buffer = getBuffer(sizeWithMargins, MaxBuffers);
+    }
+    if (!buffer) {
+        ++mStallCount;
+        QElapsedTimer stallTimer;
+        stallTimer.start();
+        while (!buffer) {
+            mDisplay->blockingReadEvents();
+            buffer = getBuffer(sizeWithMargins, MaxBuffers);
+        }
+        mStallTime += stallTimer.elapsed();
+        qCDebug(logCategory, "QWaylandShmBackingStore: stalled %lld ms waiting for the compositor to release a buffer"
+                " (%d stalls in %d frames, %lld ms in total)",
+                stallTimer.elapsed(), mStallCount, mFrameCount, mStallTime);
     }
 
     int oldSize = mBackBuffer ? mBackBuffer->image()->byteCount() : 0;
     // mBackBuffer may have been deleted here but if so it means its size was different so we wouldn't copy it anyway
-    if (mBackBuffer != buffer && oldSize == buffer->image()->byteCount()) {
-        memcpy(buffer->image()->bits(), mBackBuffer->image()->constBits(), buffer->image()->byteCount());
-    }
+    if (mBackBuffer != buffer && oldSize == buffer->image()->byteCount())
+        copyRegion(buffer->image(), *mBackBuffer->image(), buffer->dirtyRegion());
+    // Another buffer only needs the cached decoration edges to be drawn again
+    if (mBackBuffer != buffer)
+        mDecorationsDirty = true;
     mBackBuffer = buffer;
+    mBackBuffer->setDirtyRegion(QRegion());
     // ensure the new buffer is at the beginning of the list so next time getBuffer() will pick
     // it if possible
     if (mBuffers.first() != buffer) {
         mBuffers.removeOne(buffer);
         mBuffers.prepend(buffer);
     }
-
-    if (windowDecoration() && window()->isVisible())
-        windowDecoration()->update();
 }
 
 QImage *QWaylandShmBackingStore::entireSurface() const
@@ -301,42 +633,45 @@ QImage *QWaylandShmBackingStore::contentSurface() const
     return windowDecoration() ? mBackBuffer->imageInsideMargins(windowDecorationMargins()) : mBackBuffer->image();
 }
 
+// Remembers that the other buffers are now outdated in region, given
+// in device independent pixels of the entire surface.
+void QWaylandShmBackingStore::markDirty(const QRegion &region)
+{
+    if (mBuffers.count() < 2)
+        return;
+
+    const int scale = waylandWindow()->scale();
+    QRegion deviceRegion;
+    if (scale == 1) {
+        deviceRegion = region;
+    } else {
+        for (const QRect &rect : region)
+            deviceRegion += QRect(rect.topLeft() * scale, rect.size() * scale);
+    }
+
+    for (QWaylandShmBuffer *b : qAsConst(mBuffers)) {
+        if (b != mBackBuffer)
+            b->setDirtyRegion(b->dirtyRegion() + deviceRegion);
+    }
+}
+
 void QWaylandShmBackingStore::updateDecorations()
 {
+    mDecorationsDirty = false;
+    if (windowDecoration()->usesSubSurfaces()) {
+        windowDecoration()->commitSubSurfaces();
+        return;
+    }
+
+    const QRect surfaceRect(QPoint(), entireSurface()->size() / waylandWindow()->scale());
+    markDirty(QRegion(surfaceRect) - surfaceRect.marginsRemoved(windowDecorationMargins()));
+
     QPainter decorationPainter(entireSurface());
     decorationPainter.setCompositionMode(QPainter::CompositionMode_Source);
-    QImage sourceImage = windowDecoration()->contentImage();
-
-    qreal dp = sourceImage.devicePixelRatio();
-    int dpWidth = int(sourceImage.width() / dp);
-    int dpHeight = int(sourceImage.height() / dp);
-    QMatrix sourceMatrix;
-    sourceMatrix.scale(dp, dp);
-    QRect target; // needs to be in device independent pixels
-
-    //Top
-    target.setX(0);
-    target.setY(0);
-    target.setWidth(dpWidth);
-    target.setHeight(windowDecorationMargins().top());
-    decorationPainter.drawImage(target, sourceImage, sourceMatrix.mapRect(target));
-
-    //Left
-    target.setWidth(windowDecorationMargins().left());
-    target.setHeight(dpHeight);
-    decorationPainter.drawImage(target, sourceImage, sourceMatrix.mapRect(target));
-
-    //Right
-    target.setX(dpWidth - windowDecorationMargins().right());
-    target.setWidth(windowDecorationMargins().right());
-    decorationPainter.drawImage(target, sourceImage, sourceMatrix.mapRect(target));
-
-    //Bottom
-    target.setX(0);
-    target.setY(dpHeight - windowDecorationMargins().bottom());
-    target.setWidth(dpWidth);
-    target.setHeight(windowDecorationMargins().bottom());
-    decorationPainter.drawImage(target, sourceImage, sourceMatrix.mapRect(target));
+    for (int edge = 0; edge < QWaylandAbstractDecoration::EdgeCount; ++edge) {
+        const QWaylandAbstractDecoration::Edge e = QWaylandAbstractDecoration::Edge(edge);
+        decorationPainter.drawImage(windowDecoration()->edgeRect(e).topLeft(), windowDecoration()->edgeImage(e));
+    }
 }
 
 QWaylandAbstractDecoration *QWaylandShmBackingStore::windowDecoration() const
@@ -346,9 +681,7 @@ QWaylandAbstractDecoration *QWaylandShmBackingStore::windowDecoration() const
 
 QMargins QWaylandShmBackingStore::windowDecorationMargins() const
 {
-    if (windowDecoration())
-        return windowDecoration()->margins();
-    return QMargins();
+    return waylandWindow()->bufferMargins();
 }
 
 QWaylandWindow *QWaylandShmBackingStore::waylandWindow() const
@@ -55,9 +55,13 @@
 
 #include <qpa/qplatformbackingstore.h>
 #include <QtGui/QImage>
+#include <QtGui/QRegion>
 #include <qpa/qplatformwindow.h>
 #include <QMutex>
 #include <QLinkedList>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QMap>
 
 QT_BEGIN_NAMESPACE
 
@@ -66,22 +70,71 @@ namespace QtWaylandClient {
 class QWaylandDisplay;
 class QWaylandAbstractDecoration;
 class QWaylandWindow;
+class QWaylandShmPool;
 
 class Q_WAYLAND_CLIENT_EXPORT QWaylandShmBuffer : public QWaylandBuffer {
 public:
     QWaylandShmBuffer(QWaylandDisplay *display,
            const QSize &size, QImage::Format format, int scale = 1);
+    QWaylandShmBuffer(QWaylandShmPool *pool,
+           const QSize &size, QImage::Format format, int scale = 1);
     ~QWaylandShmBuffer();
     QSize size() const override { return mImage.size(); }
     int scale() const override { return int(mImage.devicePixelRatio()); }
     QImage *image() { return &mImage; }
 
     QImage *imageInsideMargins(const QMargins &margins);
+
+    // The part of the buffer that is older than the latest back buffer
+    QRegion dirtyRegion() const { return mDirtyRegion; }
+    void setDirtyRegion(const QRegion &region) { mDirtyRegion = region; }
 private:
+    void setData(uchar *data);
+
     QImage mImage;
     struct wl_shm_pool *mShmPool;
+    QWaylandShmPool *mPool;
+    int mOffset;
+    int mAllocSize;
     QMargins mMargins;
     QImage *mMarginsImage;
+    QRegion mDirtyRegion;
+
+    friend class QWaylandShmPool;
+};
+
+// A single growable shared memory file backing all the buffers of a
+// backing store. Buffers are sub-allocated at offsets inside the pool,
+// so resizing a window neither creates files nor sets up new mappings
+// unless the pool itself has to grow.
+class Q_WAYLAND_CLIENT_EXPORT QWaylandShmPool
+{
+public:
+    QWaylandShmPool(QWaylandDisplay *display);
+    ~QWaylandShmPool();
+
+    QWaylandDisplay *display() const { return mDisplay; }
+    struct wl_shm_pool *object() const { return mShmPool; }
+    uchar *data() const { return mData; }
+    int size() const { return mSize; }
+
+    static int createAnonymousFile(int size);
+
+private:
+    bool allocate(int size, int *offset);
+    void release(int offset, int size);
+    bool grow(int size);
+    void reset();
+
+    QWaylandDisplay *mDisplay;
+    struct wl_shm_pool *mShmPool;
+    int mFd;
+    uchar *mData;
+    int mSize;
+    QMap<int, int> mFreeRanges; // offset -> size
+    QList<QWaylandShmBuffer *> mBuffers;
+
+    friend class QWaylandShmBuffer;
 };
 
 class Q_WAYLAND_CLIENT_EXPORT QWaylandShmBackingStore : public QPlatformBackingStore
@@ -106,6 +159,7 @@ public:
 
     QWaylandWindow *waylandWindow() const;
     void iterateBuffer();
+    void commitDeferred();
 
 #if QT_CONFIG(opengl)
     QImage toImage() const override;
@@ -113,9 +167,14 @@ public:
 
 private:
     void updateDecorations();
-    QWaylandShmBuffer *getBuffer(const QSize &size);
+    void markDirty(const QRegion &region);
+    QWaylandShmBuffer *getBuffer(const QSize &size, int limit);
+    void updateBufferLimit();
+    void commit(const QRegion &damage);
+    bool shouldDeferCommit() const;
 
     QWaylandDisplay *mDisplay;
+    QWaylandShmPool mPool;
     QLinkedList<QWaylandShmBuffer *> mBuffers;
     QWaylandShmBuffer *mFrontBuffer;
     QWaylandShmBuffer *mBackBuffer;
@@ -124,6 +183,23 @@ private:
 
     QSize mRequestedSize;
     Qt::WindowFlags mCurrentWindowFlags;
+
+    // Damage flushed while the previous frame was still being presented
+    QRegion mDeferredDamage;
+    bool mCommitDeferred;
+    QElapsedTimer mDeferralTimer;
+    QTimer mCommitTimer;
+
+    int mBufferLimit;
+    QElapsedTimer mFrameTimer;
+    qint64 mFrameInterval;
+    qint64 mReleaseLatency;
+
+    int mFrameCount;
+    int mStallCount;
+    qint64 mStallTime;
+
+    bool mDecorationsDirty;
 };
 
 }
@@ -86,6 +86,7 @@ QWaylandWindow::QWaylandWindow(QWindow *window)
     , mMouseEventsInContentArea(false)
     , mMousePressedInContentArea(Qt::NoButton)
     , mWaitingForFrameSync(false)
+    , mConfigurePending(false)
     , mRequestResizeSent(false)
     , mCanResize(true)
     , mResizeDirty(false)
@@ -99,6 +100,10 @@ QWaylandWindow::QWaylandWindow(QWindow *window)
 {
     static WId id = 1;
     mWindowId = id++;
+    // Frame callbacks get their own queue, so that waiting for them only
+    // dispatches events for this window.
+    mFrameQueue = wl_display_create_queue(mDisplay->wl_display());
+    mDisplay->handleWindowCreated(this);
     initializeWlSurface();
 }
 
@@ -106,11 +111,15 @@ QWaylandWindow::~QWaylandWindow()
 {
     mDisplay->handleWindowDestroyed(this);
 
-    delete mWindowDecoration;
-
+    // reset() takes down the decoration subsurfaces before the surface they belong to
     if (isInitialized())
         reset();
 
+    delete mWindowDecoration;
+    mWindowDecoration = 0;
+
+    wl_event_queue_destroy(mFrameQueue);
+
     QList<QWaylandInputDevice *> inputDevices = mDisplay->inputDevices();
     for (int i = 0; i < inputDevices.size(); ++i)
         inputDevices.at(i)->handleWindowDestroyed(this);
@@ -241,6 +250,8 @@ bool QWaylandWindow::shouldCreateSubSurface() const
 
 void QWaylandWindow::reset()
 {
+    if (mWindowDecoration)
+        mWindowDecoration->destroySubSurfaces();
     delete mShellSurface;
     mShellSurface = 0;
     delete mSubSurfaceWindow;
@@ -248,10 +259,12 @@ void QWaylandWindow::reset()
     if (isInitialized())
         destroy();
 
+    QMutexLocker locker(&mFrameSyncMutex);
     if (mFrameCallback) {
         wl_callback_destroy(mFrameCallback);
         mFrameCallback = nullptr;
     }
+    mWaitingForFrameSync = false;
 }
 
 QWaylandWindow *QWaylandWindow::fromWlSurface(::wl_surface *surface)
@@ -259,6 +272,15 @@ QWaylandWindow *QWaylandWindow::fromWlSurface(::wl_surface *surface)
     return static_cast<QWaylandWindow *>(static_cast<QtWayland::wl_surface *>(wl_surface_get_user_data(surface)));
 }
 
+// Maps a position local to surface, which is this window's surface or one of its
+// decoration subsurfaces, to the coordinates of the frame
+QPointF QWaylandWindow::mapFromWlSurface(::wl_surface *surface, const QPointF &pos) const
+{
+    if (mWindowDecoration && mWindowDecoration->usesSubSurfaces())
+        return pos + mWindowDecoration->subSurfaceOffset(surface);
+    return pos;
+}
+
 WId QWaylandWindow::winId() const
 {
     return mWindowId;
@@ -291,7 +313,7 @@ void QWaylandWindow::setWindowTitle(const QString &title)
     }
 
     if (mWindowDecoration && window()->isVisible())
-        mWindowDecoration->update();
+        mWindowDecoration->update(mWindowDecoration->edgeRect(QWaylandAbstractDecoration::TopEdge));
 }
 
 void QWaylandWindow::setWindowIcon(const QIcon &icon)
@@ -299,7 +321,7 @@ void QWaylandWindow::setWindowIcon(const QIcon &icon)
     mWindowIcon = icon;
 
     if (mWindowDecoration && window()->isVisible())
-        mWindowDecoration->update();
+        mWindowDecoration->update(mWindowDecoration->edgeRect(QWaylandAbstractDecoration::TopEdge));
 }
 
 void QWaylandWindow::setGeometry_helper(const QRect &rect)
@@ -309,7 +331,7 @@ void QWaylandWindow::setGeometry_helper(const QRect &rect)
                 qBound(window()->minimumHeight(), rect.height(), window()->maximumHeight())));
 
     if (mSubSurfaceWindow) {
-        QMargins m = QPlatformWindow::parent()->frameMargins();
+        QMargins m = static_cast<QWaylandWindow *>(QPlatformWindow::parent())->bufferMargins();
         mSubSurfaceWindow->set_position(rect.x() + m.left(), rect.y() + m.top());
         mSubSurfaceWindow->parent()->window()->requestUpdate();
     }
@@ -376,6 +398,33 @@ void QWaylandWindow::lower()
         mShellSurface->lower();
 }
 
+// Sets the region of the content, in window coordinates, that changed in the
+// frame about to be swapped. Without it, the whole window is damaged.
+void QWaylandWindow::setSwapDamage(const QRegion &damage)
+{
+    QMutexLocker locker(&mSwapDamageMutex);
+    mSwapDamage = damage;
+}
+
+// Takes the damage set for the next swap as x, y, width and height of each
+// rectangle in buffer pixels, with the origin at the bottom left of a buffer
+// bufferHeight pixels high, which is what eglSwapBuffersWithDamage expects.
+QVector<int> QWaylandWindow::takeSwapDamageRects(int bufferHeight)
+{
+    QMutexLocker locker(&mSwapDamageMutex);
+    const int s = scale();
+    QVector<int> rects;
+    rects.reserve(mSwapDamage.rectCount() * 4);
+    for (const QRect &rect : mSwapDamage) {
+        rects.append(rect.x() * s);
+        rects.append(bufferHeight - (rect.y() + rect.height()) * s);
+        rects.append(rect.width() * s);
+        rects.append(rect.height() * s);
+    }
+    mSwapDamage = QRegion();
+    return rects;
+}
+
 void QWaylandWindow::setMask(const QRegion &mask)
 {
     if (mMask == mask)
@@ -403,6 +452,7 @@ void QWaylandWindow::configure(uint32_t edges, int32_t width, int32_t height)
     mConfigure.edges |= edges;
     mConfigure.width = width;
     mConfigure.height = height;
+    mConfigurePending = true;
 
     if (!mRequestResizeSent && !mConfigure.isEmpty()) {
         mRequestResizeSent= true;
@@ -474,15 +524,22 @@ void QWaylandWindow::requestResize()
 
 void QWaylandWindow::attach(QWaylandBuffer *buffer, int x, int y)
 {
+    QMutexLocker locker(&mFrameSyncMutex);
     if (mFrameCallback) {
         wl_callback_destroy(mFrameCallback);
         mFrameCallback = nullptr;
     }
 
     if (buffer) {
-        mFrameCallback = frame();
+        // Create the callback through a wrapper, so that its events can't end up
+        // on the default queue before it has been moved to ours.
+        struct ::wl_surface *wrappedSurface = static_cast<struct ::wl_surface *>(wl_proxy_create_wrapper(object()));
+        wl_proxy_set_queue(reinterpret_cast<struct ::wl_proxy *>(wrappedSurface), mFrameQueue);
+        mFrameCallback = wl_surface_frame(wrappedSurface);
+        wl_proxy_wrapper_destroy(wrappedSurface);
         wl_callback_add_listener(mFrameCallback, &QWaylandWindow::callbackListener, this);
         mWaitingForFrameSync = true;
+        locker.unlock();
         buffer->setBusy();
 
         attach(buffer->buffer(), x, y);
@@ -512,6 +569,7 @@ void QWaylandWindow::commit(QWaylandBuffer *buffer, const QRegion &damage)
     for (const QRect &rect: rects)
         wl_surface::damage(rect.x(), rect.y(), rect.width(), rect.height());
     wl_surface::commit();
+    mConfigurePending = false;
 }
 
 const wl_callback_listener QWaylandWindow::callbackListener = {
@@ -520,27 +578,59 @@ const wl_callback_listener QWaylandWindow::callbackListener = {
 
 void QWaylandWindow::frameCallback(void *data, struct wl_callback *callback, uint32_t time)
 {
+    Q_UNUSED(callback);
     Q_UNUSED(time);
     QWaylandWindow *self = static_cast<QWaylandWindow*>(data);
 
+    // Always called with mFrameSyncMutex held, but possibly from the thread
+    // waiting in waitForFrameSync(), so leave the rest to the window's own thread.
     self->mWaitingForFrameSync = false;
-    if (self->mUpdateRequested) {
-        QWindowPrivate *w = QWindowPrivate::get(self->window());
-        self->mUpdateRequested = false;
-        w->deliverUpdateRequest();
-    }
+    QMetaObject::invokeMethod(self, "handleFrameCallback", Qt::QueuedConnection);
 }
 
-QMutex QWaylandWindow::mFrameSyncMutex;
+void QWaylandWindow::handleFrameCallback()
+{
+    if (mBackingStore)
+        mBackingStore->commitDeferred();
 
+    if (mUpdateRequested) {
+        mUpdateRequested = false;
+        QWindowPrivate::get(window())->deliverUpdateRequest();
+    }
+}
+
+// Only this window's frame queue is dispatched while waiting, so windows
+// rendering in different threads don't wait for each other.
 void QWaylandWindow::waitForFrameSync()
 {
     QMutexLocker locker(&mFrameSyncMutex);
     if (!mWaitingForFrameSync)
         return;
-    mDisplay->flushRequests();
+
+    wl_display_flush(mDisplay->wl_display());
     while (mWaitingForFrameSync)
-        mDisplay->blockingReadEvents();
+        mDisplay->blockingReadEvents(mFrameQueue);
+
+    // Reading the frame callback may have also read events for the default
+    // queue, which the main thread won't be woken up for.
+    QMetaObject::invokeMethod(mDisplay, "flushRequests", Qt::QueuedConnection);
+}
+
+bool QWaylandWindow::isWaitingForFrameSync()
+{
+    QMutexLocker locker(&mFrameSyncMutex);
+    return mWaitingForFrameSync;
+}
+
+// Called from the main thread or the event thread for frame callbacks that have
+// already been read, unless a thread is waiting in waitForFrameSync() and will
+// dispatch them itself.
+void QWaylandWindow::dispatchFrameCallbacks()
+{
+    if (!mFrameSyncMutex.tryLock())
+        return;
+    wl_display_dispatch_queue_pending(mDisplay->wl_display(), mFrameQueue);
+    mFrameSyncMutex.unlock();
 }
 
 QMargins QWaylandWindow::frameMargins() const
@@ -550,6 +640,15 @@ QMargins QWaylandWindow::frameMargins() const
     return QPlatformWindow::frameMargins();
 }
 
+// The part of the frame margins that is drawn into the window's own buffers,
+// none when the decoration is in subsurfaces
+QMargins QWaylandWindow::bufferMargins() const
+{
+    if (mWindowDecoration && !mWindowDecoration->usesSubSurfaces())
+        return mWindowDecoration->margins();
+    return QMargins();
+}
+
 QWaylandShellSurface *QWaylandWindow::shellSurface() const
 {
     return mShellSurface;
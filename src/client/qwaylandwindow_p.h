@@ -132,12 +132,17 @@ public:
     void damage(const QRect &rect);
 
     void commit(QWaylandBuffer *buffer, const QRegion &damage);
+    bool hasPendingConfigure() const { return mConfigurePending; }
 
     void waitForFrameSync();
+    bool isWaitingForFrameSync();
+    void dispatchFrameCallbacks();
 
     QMargins frameMargins() const override;
+    QMargins bufferMargins() const;
 
     static QWaylandWindow *fromWlSurface(::wl_surface *surface);
+    QPointF mapFromWlSurface(::wl_surface *surface, const QPointF &pos) const;
 
     QWaylandDisplay *display() const { return mDisplay; }
     QWaylandShellSurface *shellSurface() const;
@@ -155,6 +160,10 @@ public:
 
     void setMask(const QRegion &region) override;
 
+    void setSwapDamage(const QRegion &damage);
+    QVector<int> takeSwapDamageRects(int bufferHeight);
+    virtual int bufferAge() const { return 0; }
+
     int scale() const;
     qreal devicePixelRatio() const override;
 
@@ -208,6 +217,9 @@ public:
 public slots:
     void requestResize();
 
+private slots:
+    void handleFrameCallback();
+
 protected:
     QWaylandScreen *mScreen;
     QWaylandDisplay *mDisplay;
@@ -222,10 +234,12 @@ protected:
     WId mWindowId;
     bool mWaitingForFrameSync;
     struct ::wl_callback *mFrameCallback = nullptr;
-    QWaitCondition mFrameSyncWait;
+    struct ::wl_event_queue *mFrameQueue = nullptr;
+    QMutex mFrameSyncMutex;
 
     QMutex mResizeLock;
     QWaylandWindowConfigure mConfigure;
+    bool mConfigurePending; // until the next commit answers it
     bool mRequestResizeSent;
     bool mCanResize;
     bool mResizeDirty;
@@ -241,6 +255,8 @@ protected:
     Qt::WindowState mState;
     Qt::WindowFlags mFlags;
     QRegion mMask;
+    QRegion mSwapDamage;
+    QMutex mSwapDamageMutex;
 
     QWaylandShmBackingStore *mBackingStore;
 
@@ -261,7 +277,6 @@ private:
     static const wl_callback_listener callbackListener;
     static void frameCallback(void *data, struct wl_callback *wl_callback, uint32_t time);
 
-    static QMutex mFrameSyncMutex;
     static QWaylandWindow *mMouseGrab;
 
     friend class QWaylandSubSurface;
@@ -173,10 +173,8 @@ void QWaylandWlShellSurface::updateTransientParent(QWindow *parent)
     // set_transient expects a position relative to the parent
     QPoint transientPos = m_window->geometry().topLeft(); // this is absolute
     transientPos -= parent->geometry().topLeft();
-    if (parent_wayland_window->decoration()) {
-        transientPos.setX(transientPos.x() + parent_wayland_window->decoration()->margins().left());
-        transientPos.setY(transientPos.y() + parent_wayland_window->decoration()->margins().top());
-    }
+    transientPos.setX(transientPos.x() + parent_wayland_window->bufferMargins().left());
+    transientPos.setY(transientPos.y() + parent_wayland_window->bufferMargins().top());
 
     uint32_t flags = 0;
     Qt::WindowFlags wf = m_window->window()->flags();
@@ -206,10 +204,8 @@ void QWaylandWlShellSurface::setPopup(QWaylandWindow *parent, QWaylandInputDevic
     // set_popup expects a position relative to the parent
     QPoint transientPos = m_window->geometry().topLeft(); // this is absolute
     transientPos -= parent_wayland_window->geometry().topLeft();
-    if (parent_wayland_window->decoration()) {
-        transientPos.setX(transientPos.x() + parent_wayland_window->decoration()->margins().left());
-        transientPos.setY(transientPos.y() + parent_wayland_window->decoration()->margins().top());
-    }
+    transientPos.setX(transientPos.x() + parent_wayland_window->bufferMargins().left());
+    transientPos.setY(transientPos.y() + parent_wayland_window->bufferMargins().top());
 
     set_popup(device->wl_seat(), serial, parent_wayland_window->object(),
               transientPos.x(), transientPos.y(), 0);
@@ -55,6 +55,7 @@ public:
     QWaylandClientPrivate(QWaylandCompositor *compositor, wl_client *_client)
         : compositor(compositor)
         , client(_client)
+        , frameCallbackInterval(0)
     {
         // Save client credentials
         wl_client_get_credentials(client, &pid, &uid, &gid);
@@ -80,6 +81,8 @@ public:
     gid_t gid;
     pid_t pid;
 
+    int frameCallbackInterval;
+
     struct Listener {
         wl_listener listener;
         QWaylandClient *parent;
@@ -251,6 +254,43 @@ qint64 QWaylandClient::processId() const
     return d->pid;
 }
 
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandClient::frameCallbackInterval
+ * \since 5.10
+ *
+ * This property holds the minimum time in milliseconds between two frame
+ * callbacks sent to a surface of this client. It caps the rate at which the
+ * client is asked to redraw, e.g. for background applications.
+ *
+ * The default is 0, meaning frame callbacks are sent on every output frame.
+ */
+
+/*!
+ * \property QWaylandClient::frameCallbackInterval
+ * \since 5.10
+ *
+ * This property holds the minimum time in milliseconds between two frame
+ * callbacks sent to a surface of this client. It caps the rate at which the
+ * client is asked to redraw, e.g. for background applications.
+ *
+ * The default is 0, meaning frame callbacks are sent on every output frame.
+ */
+int QWaylandClient::frameCallbackInterval() const
+{
+    Q_D(const QWaylandClient);
+    return d->frameCallbackInterval;
+}
+
+void QWaylandClient::setFrameCallbackInterval(int msecs)
+{
+    Q_D(QWaylandClient);
+    msecs = qMax(msecs, 0);
+    if (d->frameCallbackInterval == msecs)
+        return;
+    d->frameCallbackInterval = msecs;
+    emit frameCallbackIntervalChanged();
+}
+
 /*!
  * \qmlmethod void QtWaylandCompositor::WaylandClient::kill(signal)
  *
@@ -62,6 +62,7 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandClient : public QObject
     Q_PROPERTY(qint64 userId READ userId CONSTANT)
     Q_PROPERTY(qint64 groupId READ groupId CONSTANT)
     Q_PROPERTY(qint64 processId READ processId CONSTANT)
+    Q_PROPERTY(int frameCallbackInterval READ frameCallbackInterval WRITE setFrameCallbackInterval NOTIFY frameCallbackIntervalChanged)
 public:
     ~QWaylandClient();
 
@@ -76,11 +77,17 @@ public:
 
     qint64 processId() const;
 
+    int frameCallbackInterval() const;
+    void setFrameCallbackInterval(int msecs);
+
     Q_INVOKABLE void kill(int signal = SIGTERM);
 
 public Q_SLOTS:
     void close();
 
+Q_SIGNALS:
+    void frameCallbackIntervalChanged();
+
 private:
     explicit QWaylandClient(QWaylandCompositor *compositor, wl_client *client);
 };
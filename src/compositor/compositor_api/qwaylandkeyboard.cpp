@@ -48,12 +48,35 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QStandardPaths>
+#if QT_CONFIG(xkbcommon_evdev)
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QHash>
+#include <QtCore/QSaveFile>
+#endif
 
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #if QT_CONFIG(xkbcommon_evdev)
-#include <sys/mman.h>
 #include <sys/types.h>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
 #endif
 
 QT_BEGIN_NAMESPACE
@@ -70,7 +93,7 @@ QWaylandKeyboardPrivate::QWaylandKeyboardPrivate(QWaylandSeat *seat)
     , group()
     , pendingKeymap(false)
 #if QT_CONFIG(xkbcommon_evdev)
-    , keymap_fd(-1)
+    , xkb_context(0)
     , xkb_state(0)
 #endif
     , repeatRate(40)
@@ -82,11 +105,9 @@ QWaylandKeyboardPrivate::~QWaylandKeyboardPrivate()
 {
 #if QT_CONFIG(xkbcommon_evdev)
     if (xkb_context) {
-        if (keymap_area)
-            munmap(keymap_area, keymap_size);
-        close(keymap_fd);
+        if (xkb_state)
+            xkb_state_unref(xkb_state);
         xkb_context_unref(xkb_context);
-        xkb_state_unref(xkb_state);
     }
 #endif
 }
@@ -112,6 +133,13 @@ void QWaylandKeyboardPrivate::checkFocusResource(Resource *keyboardResource)
     }
 }
 
+// The resource most recently bound by client, looked up in the per-client index
+QtWaylandServer::wl_keyboard::Resource *QWaylandKeyboardPrivate::clientResource(struct ::wl_client *client) const
+{
+    const QVector<Resource *> &resources = resourcesForClient(client);
+    return resources.isEmpty() ? nullptr : resources.last();
+}
+
 void QWaylandKeyboardPrivate::sendEnter(QWaylandSurface *surface, Resource *keyboardResource)
 {
     uint32_t serial = compositor()->nextSerial();
@@ -133,7 +161,7 @@ void QWaylandKeyboardPrivate::focused(QWaylandSurface *surface)
             focusDestroyListener.listenForDestruction(surface->resource());
     }
 
-    Resource *resource = surface ? resourceMap().value(surface->waylandClient()) : 0;
+    Resource *resource = surface ? clientResource(surface->waylandClient()) : 0;
 
     if (resource && (focus != surface || focusResource != resource))
         sendEnter(surface, resource);
@@ -151,9 +179,9 @@ void QWaylandKeyboardPrivate::keyboard_bind_resource(wl_keyboard::Resource *reso
         send_repeat_info(resource->handle, repeatRate, repeatDelay);
 
 #if QT_CONFIG(xkbcommon_evdev)
-    if (xkb_context) {
+    if (sharedKeymap) {
         send_keymap(resource->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
-                    keymap_fd, keymap_size);
+                    sharedKeymap->fd, sharedKeymap->size);
     } else
 #endif
     {
@@ -214,7 +242,7 @@ void QWaylandKeyboardPrivate::modifiers(uint32_t serial, uint32_t mods_depressed
 void QWaylandKeyboardPrivate::updateModifierState(uint code, uint32_t state)
 {
 #if QT_CONFIG(xkbcommon_evdev)
-    if (!xkb_context)
+    if (!xkb_state)
         return;
 
     xkb_state_update_key(xkb_state, code, state == WL_KEYBOARD_KEY_STATE_PRESSED ? XKB_KEY_DOWN : XKB_KEY_UP);
@@ -258,8 +286,11 @@ void QWaylandKeyboardPrivate::maybeUpdateKeymap()
         return;
 
     createXKBKeymap();
+    if (!sharedKeymap)
+        return;
+
     foreach (Resource *res, resourceMap()) {
-        send_keymap(res->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, keymap_fd, keymap_size);
+        send_keymap(res->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, sharedKeymap->fd, sharedKeymap->size);
     }
 
     xkb_state_update_mask(xkb_state, 0, modsLatched, modsLocked, 0, 0, 0);
@@ -304,46 +335,226 @@ static int createAnonymousFile(size_t size)
     return fd;
 }
 
-void QWaylandKeyboardPrivate::initXKB()
+static bool writeAll(int fd, const char *data, size_t size)
 {
-    xkb_context = xkb_context_new(static_cast<xkb_context_flags>(0));
-    if (!xkb_context) {
-        qWarning("Failed to create a XKB context: keymap will not be supported");
-        return;
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
     }
+    return true;
+}
+
+// Creates a file holding the keymap text that can be handed to any number of
+// clients. With memfd the file is sealed so nobody can modify or resize it;
+// otherwise we fall back to a regular anonymous file.
+static int createKeymapFile(const char *text, size_t size)
+{
+    int fd = -1;
+#if defined(Q_OS_LINUX) && defined(SYS_memfd_create)
+    fd = syscall(SYS_memfd_create, "qtwayland-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd >= 0) {
+        if (!writeAll(fd, text, size)
+                || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+    if (fd >= 0)
+        return fd;
 
-    createXKBKeymap();
+    fd = createAnonymousFile(size);
+    if (fd < 0) {
+        qWarning("Failed to create anonymous file of size %lu", static_cast<unsigned long>(size));
+        return -1;
+    }
+
+    if (!writeAll(fd, text, size)) {
+        qWarning("Failed to write the XKB keymap");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
 }
 
+struct QWaylandSharedKeymap
+{
+    QWaylandSharedKeymap() : keymap(0), fd(-1), size(0) {}
+    ~QWaylandSharedKeymap()
+    {
+        if (fd >= 0)
+            close(fd);
+        xkb_keymap_unref(keymap);
+    }
 
-void QWaylandKeyboardPrivate::createXKBState(xkb_keymap *keymap)
+    struct xkb_keymap *keymap;
+    int fd;
+    size_t size;
+};
+
+// Compiled keymaps shared by every keyboard in the process, keyed by the
+// rules/model/layout/variant/options names. Compiling a keymap from names
+// takes tens of milliseconds, so seats using the same layout, and layout
+// switches back to a recently used one, reuse the compiled keymap and the
+// file that is sent to clients.
+//
+// If QT_WAYLAND_XKB_KEYMAP_CACHE_DIR is set, the serialized keymaps are also
+// stored in that directory and loaded from there on the next start. The cache
+// is not invalidated automatically; clear it when the XKB data is updated.
+class QWaylandKeymapCache
+{
+public:
+    QWaylandKeymapCache();
+    ~QWaylandKeymapCache();
+
+    struct xkb_context *context() const { return m_context; }
+    QSharedPointer<QWaylandSharedKeymap> keymap(const QWaylandKeymap *names);
+
+private:
+    enum { MaxRecentKeymaps = 8 };
+
+    QString diskCacheFile(const QByteArray &key) const;
+    struct xkb_keymap *compile(const QWaylandKeymap *names, const QByteArray &key);
+
+    struct xkb_context *m_context;
+    QString m_diskCacheDir;
+    QHash<QByteArray, QSharedPointer<QWaylandSharedKeymap> > m_keymaps;
+    QList<QByteArray> m_recent;
+};
+
+Q_GLOBAL_STATIC(QWaylandKeymapCache, keymapCache)
+
+QWaylandKeymapCache::QWaylandKeymapCache()
+    : m_context(xkb_context_new(static_cast<xkb_context_flags>(0)))
+    , m_diskCacheDir(QFile::decodeName(qgetenv("QT_WAYLAND_XKB_KEYMAP_CACHE_DIR")))
+{
+    if (!m_diskCacheDir.isEmpty() && !QDir().mkpath(m_diskCacheDir)) {
+        qWarning("Failed to create the XKB keymap cache directory %s", qPrintable(m_diskCacheDir));
+        m_diskCacheDir.clear();
+    }
+}
+
+QWaylandKeymapCache::~QWaylandKeymapCache()
 {
-    char *keymap_str = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
-    if (!keymap_str) {
-        qWarning("Failed to compile global XKB keymap");
-        return;
+    m_keymaps.clear();
+    if (m_context)
+        xkb_context_unref(m_context);
+}
+
+QString QWaylandKeymapCache::diskCacheFile(const QByteArray &key) const
+{
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+    return m_diskCacheDir + QLatin1Char('/') + QLatin1String(hash) + QLatin1String(".xkb");
+}
+
+struct xkb_keymap *QWaylandKeymapCache::compile(const QWaylandKeymap *names, const QByteArray &key)
+{
+    if (!m_diskCacheDir.isEmpty()) {
+        QFile file(diskCacheFile(key));
+        if (file.open(QIODevice::ReadOnly)) {
+            const QByteArray text = file.readAll();
+            struct xkb_keymap *keymap = xkb_keymap_new_from_string(m_context, text.constData(),
+                                                                   XKB_KEYMAP_FORMAT_TEXT_V1,
+                                                                   static_cast<xkb_keymap_compile_flags>(0));
+            if (keymap)
+                return keymap;
+            qWarning("Ignoring invalid cached XKB keymap %s", qPrintable(file.fileName()));
+        }
     }
 
-    keymap_size = strlen(keymap_str) + 1;
-    if (keymap_fd >= 0)
-        close(keymap_fd);
-    keymap_fd = createAnonymousFile(keymap_size);
-    if (keymap_fd < 0) {
-        qWarning("Failed to create anonymous file of size %lu", static_cast<unsigned long>(keymap_size));
-        return;
+    const QByteArray rules = names->rules().toLocal8Bit();
+    const QByteArray model = names->model().toLocal8Bit();
+    const QByteArray layout = names->layout().toLocal8Bit();
+    const QByteArray variant = names->variant().toLocal8Bit();
+    const QByteArray options = names->options().toLocal8Bit();
+    struct xkb_rule_names rule_names = { rules.constData(),
+                                         model.constData(),
+                                         layout.constData(),
+                                         variant.constData(),
+                                         options.constData() };
+    struct xkb_keymap *keymap = xkb_keymap_new_from_names(m_context, &rule_names, static_cast<xkb_keymap_compile_flags>(0));
+    if (!keymap || m_diskCacheDir.isEmpty())
+        return keymap;
+
+    char *text = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    if (text) {
+        QSaveFile file(diskCacheFile(key));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(text);
+            file.commit();
+        }
+        free(text);
+    }
+    return keymap;
+}
+
+QSharedPointer<QWaylandSharedKeymap> QWaylandKeymapCache::keymap(const QWaylandKeymap *names)
+{
+    if (!m_context)
+        return QSharedPointer<QWaylandSharedKeymap>();
+
+    const QByteArray key = QStringList({ names->rules(), names->model(), names->layout(),
+                                         names->variant(), names->options() }).join(QChar(0)).toUtf8();
+
+    QSharedPointer<QWaylandSharedKeymap> shared = m_keymaps.value(key);
+    if (shared) {
+        m_recent.removeOne(key);
+        m_recent.append(key);
+        return shared;
+    }
+
+    struct xkb_keymap *keymap = compile(names, key);
+    if (!keymap) {
+        qWarning("Failed to load the '%s' XKB keymap.", qPrintable(names->layout()));
+        return shared;
     }
 
-    keymap_area = static_cast<char *>(mmap(0, keymap_size, PROT_READ | PROT_WRITE, MAP_SHARED, keymap_fd, 0));
-    if (keymap_area == MAP_FAILED) {
-        close(keymap_fd);
-        keymap_fd = -1;
-        qWarning("Failed to map shared memory segment");
+    char *text = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    if (!text) {
+        qWarning("Failed to compile global XKB keymap");
+        xkb_keymap_unref(keymap);
+        return shared;
+    }
+
+    shared.reset(new QWaylandSharedKeymap);
+    shared->keymap = keymap;
+    shared->size = strlen(text) + 1;
+    shared->fd = createKeymapFile(text, shared->size);
+    free(text);
+    if (shared->fd < 0)
+        return QSharedPointer<QWaylandSharedKeymap>();
+
+    // Keyboards hold on to the keymaps they use; the cache only keeps the
+    // most recently used ones alive for layout switches.
+    m_keymaps.insert(key, shared);
+    m_recent.append(key);
+    while (m_recent.size() > MaxRecentKeymaps)
+        m_keymaps.remove(m_recent.takeFirst());
+
+    return shared;
+}
+
+void QWaylandKeyboardPrivate::initXKB()
+{
+    xkb_context = keymapCache()->context();
+    if (!xkb_context) {
+        qWarning("Failed to create a XKB context: keymap will not be supported");
         return;
     }
+    xkb_context_ref(xkb_context);
 
-    strcpy(keymap_area, keymap_str);
-    free(keymap_str);
+    createXKBKeymap();
+}
 
+void QWaylandKeyboardPrivate::createXKBState(xkb_keymap *keymap)
+{
     if (xkb_state)
         xkb_state_unref(xkb_state);
     xkb_state = xkb_state_new(keymap);
@@ -361,26 +572,12 @@ void QWaylandKeyboardPrivate::createXKBKeymap()
     if (!xkb_context)
         return;
 
-    auto keymap = seat->keymap();
-    struct xkb_rule_names rule_names = { strdup(qPrintable(keymap->rules())),
-                                         strdup(qPrintable(keymap->model())),
-                                         strdup(qPrintable(keymap->layout())),
-                                         strdup(qPrintable(keymap->variant())),
-                                         strdup(qPrintable(keymap->options())) };
-    struct xkb_keymap *xkbKeymap = xkb_keymap_new_from_names(xkb_context, &rule_names, static_cast<xkb_keymap_compile_flags>(0));
-
-    if (xkbKeymap) {
-        createXKBState(xkbKeymap);
-        xkb_keymap_unref(xkbKeymap);
-    } else {
-        qWarning("Failed to load the '%s' XKB keymap.", qPrintable(keymap->layout()));
-    }
+    QSharedPointer<QWaylandSharedKeymap> keymap = keymapCache()->keymap(seat->keymap());
+    if (!keymap)
+        return;
 
-    free((char *)rule_names.rules);
-    free((char *)rule_names.model);
-    free((char *)rule_names.layout);
-    free((char *)rule_names.variant);
-    free((char *)rule_names.options);
+    sharedKeymap = keymap;
+    createXKBState(sharedKeymap->keymap);
 }
 #endif
 
@@ -476,7 +673,7 @@ QWaylandClient *QWaylandKeyboard::focusClient() const
 void QWaylandKeyboard::sendKeyModifiers(QWaylandClient *client, uint serial)
 {
     Q_D(QWaylandKeyboard);
-    QtWaylandServer::wl_keyboard::Resource *resource = d->resourceMap().value(client->client());
+    QtWaylandServer::wl_keyboard::Resource *resource = d->clientResource(client->client());
     if (resource)
         d->send_modifiers(resource->handle, serial, d->modsDepressed, d->modsLatched, d->modsLocked, d->group);
 }
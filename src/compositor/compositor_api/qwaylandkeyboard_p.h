@@ -60,6 +60,7 @@
 #include <QtCore/private/qobject_p.h>
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 
+#include <QtCore/QSharedPointer>
 #include <QtCore/QVector>
 
 #if QT_CONFIG(xkbcommon_evdev)
@@ -69,6 +70,10 @@
 
 QT_BEGIN_NAMESPACE
 
+#if QT_CONFIG(xkbcommon_evdev)
+struct QWaylandSharedKeymap;
+#endif
+
 class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandKeyboardPrivate : public QObjectPrivate
                                                   , public QtWaylandServer::wl_keyboard
 {
@@ -98,6 +103,7 @@ public:
 
     void checkFocusResource(Resource *resource);
     void sendEnter(QWaylandSurface *surface, Resource *resource);
+    Resource *clientResource(struct ::wl_client *client) const;
 
 protected:
     void keyboard_bind_resource(Resource *resource) override;
@@ -128,9 +134,7 @@ private:
 
     bool pendingKeymap;
 #if QT_CONFIG(xkbcommon_evdev)
-    size_t keymap_size;
-    int keymap_fd;
-    char *keymap_area;
+    QSharedPointer<QWaylandSharedKeymap> sharedKeymap;
     struct xkb_context *xkb_context;
     struct xkb_state *xkb_state;
 #endif
@@ -46,6 +46,7 @@
 
 #include <QtWaylandCompositor/private/qwaylandsurface_p.h>
 #include <QtWaylandCompositor/private/qwaylandcompositor_p.h>
+#include <QtWaylandCompositor/private/qwaylandpointer_p.h>
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QtMath>
@@ -113,7 +114,9 @@ QWaylandOutputPrivate::QWaylandOutputPrivate()
     , scaleFactor(1)
     , sizeFollowsWindow(false)
     , initialized(false)
+    , hiddenFrameCallbackInterval(0)
 {
+    frameCallbackTimer.setSingleShot(true);
 }
 
 QWaylandOutputPrivate::~QWaylandOutputPrivate()
@@ -208,6 +211,8 @@ void QWaylandOutputPrivate::removeView(QWaylandView *view, QWaylandSurface *surf
 QWaylandOutput::QWaylandOutput()
     : QWaylandObject(*new QWaylandOutputPrivate())
 {
+    Q_D(QWaylandOutput);
+    connect(&d->frameCallbackTimer, &QTimer::timeout, this, &QWaylandOutput::sendFrameCallbacks);
 }
 
 /*!
@@ -252,6 +257,7 @@ QWaylandOutput::QWaylandOutput(QWaylandCompositor *compositor, QWindow *window)
     Q_D(QWaylandOutput);
     d->compositor = compositor;
     d->window = window;
+    connect(&d->frameCallbackTimer, &QTimer::timeout, this, &QWaylandOutput::sendFrameCallbacks);
     QWaylandCompositorPrivate::get(compositor)->addPolishObject(this);
 }
 
@@ -835,6 +841,57 @@ void QWaylandOutput::setSizeFollowsWindow(bool follow)
     }
 }
 
+/*!
+ * \qmlproperty int QtWaylandCompositor::WaylandOutput::hiddenFrameCallbackInterval
+ * \since 5.10
+ *
+ * This property holds the minimum time in milliseconds between two frame
+ * callbacks sent to a surface whose primary view is on this output, while
+ * none of the surface's views are visible. This keeps clients that are
+ * hidden, minimized or covered from redrawing at the full refresh rate.
+ *
+ * A value of 0 sends frame callbacks on every frame, as for visible surfaces.
+ * A negative value suspends frame callbacks until a view becomes visible.
+ *
+ * The default is 0, so hidden surfaces are not throttled unless a positive
+ * interval is set.
+ *
+ * \sa WaylandView::visible
+ */
+
+/*!
+ * \property QWaylandOutput::hiddenFrameCallbackInterval
+ * \since 5.10
+ *
+ * This property holds the minimum time in milliseconds between two frame
+ * callbacks sent to a surface whose primary view is on this output, while
+ * none of the surface's views are visible. This keeps clients that are
+ * hidden, minimized or covered from redrawing at the full refresh rate.
+ *
+ * A value of 0 sends frame callbacks on every frame, as for visible surfaces.
+ * A negative value suspends frame callbacks until a view becomes visible.
+ *
+ * The default is 0, so hidden surfaces are not throttled unless a positive
+ * interval is set.
+ *
+ * \sa QWaylandView::visible
+ */
+int QWaylandOutput::hiddenFrameCallbackInterval() const
+{
+    return d_func()->hiddenFrameCallbackInterval;
+}
+
+void QWaylandOutput::setHiddenFrameCallbackInterval(int msecs)
+{
+    Q_D(QWaylandOutput);
+    if (msecs < 0)
+        msecs = -1;
+    if (msecs == d->hiddenFrameCallbackInterval)
+        return;
+    d->hiddenFrameCallbackInterval = msecs;
+    Q_EMIT hiddenFrameCallbackIntervalChanged();
+}
+
 /*!
  * \qmlproperty object QtWaylandCompositor::WaylandOutput::window
  *
@@ -878,14 +935,33 @@ void QWaylandOutput::frameStarted()
         if (surfacemapper.maybePrimaryView())
             surfacemapper.surface->frameStarted();
     }
+
+    if (!d->compositor)
+        return;
+
+    // Pointer motion is held back until the frame it is shown in
+    const auto seats = QWaylandCompositorPrivate::get(d->compositor)->seats;
+    for (QWaylandSeat *seat : seats) {
+        QWaylandPointer *pointer = seat->pointer();
+        if (pointer && (!pointer->output() || pointer->output() == this))
+            QWaylandPointerPrivate::get(pointer)->frameStarted();
+    }
 }
 
 /*!
  * Sends pending frame callbacks.
+ *
+ * Callbacks of surfaces that have no visible view are held back according to
+ * hiddenFrameCallbackInterval, and those of clients with a
+ * QWaylandClient::frameCallbackInterval are sent no more often than that.
+ * Callbacks that are held back are sent once they are due, even if no new
+ * frame is started by then.
  */
 void QWaylandOutput::sendFrameCallbacks()
 {
     Q_D(QWaylandOutput);
+    const uint time = d->compositor->currentTimeMsecs();
+    int nextDelay = -1;
     for (int i = 0; i < d->surfaceViews.size(); i++) {
         const QWaylandSurfaceViewMapper &surfacemapper = d->surfaceViews.at(i);
         if (surfacemapper.surface && surfacemapper.surface->hasContent()) {
@@ -893,13 +969,44 @@ void QWaylandOutput::sendFrameCallbacks()
                 surfaceEnter(surfacemapper.surface);
                 d->surfaceViews[i].has_entered = true;
             }
-            if (surfacemapper.maybePrimaryView())
+            if (!surfacemapper.maybePrimaryView())
+                continue;
+
+            const int delay = d->frameCallbackDelay(surfacemapper.surface, time);
+            if (delay == 0)
                 surfacemapper.surface->sendFrameCallbacks();
+            else if (delay > 0 && QWaylandSurfacePrivate::get(surfacemapper.surface)->hasFrameCallbacksToSend())
+                nextDelay = nextDelay < 0 ? delay : qMin(nextDelay, delay);
         }
     }
+    if (nextDelay > 0)
+        d->frameCallbackTimer.start(nextDelay);
     wl_display_flush_clients(d->compositor->display());
 }
 
+/*
+ * Returns how many milliseconds the frame callbacks of \a surface have to wait
+ * before they may be sent, or -1 if they are suspended.
+ */
+int QWaylandOutputPrivate::frameCallbackDelay(QWaylandSurface *surface, uint time) const
+{
+    QWaylandSurfacePrivate *surfacePrivate = QWaylandSurfacePrivate::get(surface);
+    QWaylandClient *client = surface->client();
+    int interval = client ? client->frameCallbackInterval() : 0;
+
+    if (!surfacePrivate->hasVisibleView()) {
+        if (hiddenFrameCallbackInterval < 0)
+            return -1;
+        interval = qMax(interval, hiddenFrameCallbackInterval);
+    }
+
+    if (interval <= 0 || !surfacePrivate->frameCallbackSent)
+        return 0;
+
+    const uint elapsed = time - surfacePrivate->lastFrameCallbackTime;
+    return elapsed >= uint(interval) ? 0 : interval - int(elapsed);
+}
+
 /*!
  * \internal
  */
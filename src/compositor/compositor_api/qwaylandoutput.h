@@ -77,6 +77,7 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandOutput : public QWaylandObject
     Q_PROPERTY(QWaylandOutput::Transform transform READ transform WRITE setTransform NOTIFY transformChanged)
     Q_PROPERTY(int scaleFactor READ scaleFactor WRITE setScaleFactor NOTIFY scaleFactorChanged)
     Q_PROPERTY(bool sizeFollowsWindow READ sizeFollowsWindow WRITE setSizeFollowsWindow NOTIFY sizeFollowsWindowChanged)
+    Q_PROPERTY(int hiddenFrameCallbackInterval READ hiddenFrameCallbackInterval WRITE setHiddenFrameCallbackInterval NOTIFY hiddenFrameCallbackIntervalChanged)
     Q_ENUMS(Subpixel Transform)
 
 public:
@@ -154,6 +155,9 @@ public:
     bool physicalSizeFollowsSize() const;
     void setPhysicalSizeFollowsSize(bool follow);
 
+    int hiddenFrameCallbackInterval() const;
+    void setHiddenFrameCallbackInterval(int msecs);
+
     void frameStarted();
     void sendFrameCallbacks();
 
@@ -176,6 +180,7 @@ Q_SIGNALS:
     void transformChanged();
     void sizeFollowsWindowChanged();
     void physicalSizeFollowsSizeChanged();
+    void hiddenFrameCallbackIntervalChanged();
     void manufacturerChanged();
     void modelChanged();
     void windowDestroyed();
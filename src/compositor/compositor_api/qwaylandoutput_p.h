@@ -61,6 +61,7 @@
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
 
 #include <QtCore/QRect>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
 
 #include <QtCore/private/qobject_p.h>
@@ -112,6 +113,8 @@ public:
     void sendMode(const Resource *resource, const QWaylandOutputMode &mode);
     void sendModesInfo();
 
+    int frameCallbackDelay(QWaylandSurface *surface, uint time) const;
+
 protected:
     void output_bind_resource(Resource *resource) override;
 
@@ -132,6 +135,8 @@ private:
     int scaleFactor;
     bool sizeFollowsWindow;
     bool initialized;
+    int hiddenFrameCallbackInterval;
+    QTimer frameCallbackTimer;
 
     Q_DECLARE_PUBLIC(QWaylandOutput)
     Q_DISABLE_COPY(QWaylandOutputPrivate)
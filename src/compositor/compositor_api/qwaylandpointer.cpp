@@ -41,6 +41,8 @@
 #include "qwaylandpointer_p.h"
 #include <QtWaylandCompositor/QWaylandClient>
 #include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandOutput>
+#include <QtCore/QThread>
 
 QT_BEGIN_NAMESPACE
 
@@ -54,28 +56,67 @@ QWaylandPointerPrivate::QWaylandPointerPrivate(QWaylandPointer *pointer, QWaylan
     , hasSentEnter(false)
     , enterSerial(0)
     , buttonCount()
+    , hasPendingMotion(false)
+    , pendingMotionTime(0)
 {
     Q_UNUSED(pointer);
+    motionTimer.setSingleShot(true);
 }
 
-const QList<QtWaylandServer::wl_pointer::Resource *> QWaylandPointerPrivate::pointerResourcesForFocusedSurface() const
+void QWaylandPointerPrivate::updateFocusResources()
 {
-    if (!seat->mouseFocus())
-        return {};
+    focusResources.clear();
+    if (QWaylandView *focus = seat->mouseFocus())
+        focusResources = resourcesForClient(focus->surfaceResource()->client);
+}
+
+// Motion events are coalesced until the next frame starts on the pointer's
+// output, as clients can't make use of more than one position per frame.
+// Anything else sent to the client flushes the pending motion first, to
+// keep the events in order.
+void QWaylandPointerPrivate::sendPendingMotion()
+{
+    if (!hasPendingMotion)
+        return;
+
+    hasPendingMotion = false;
+    motionTimer.stop();
 
-    return resourceMap().values(seat->mouseFocus()->surfaceResource()->client);
+    wl_fixed_t x = wl_fixed_from_double(localPosition.x());
+    wl_fixed_t y = wl_fixed_from_double(localPosition.y());
+    for (Resource *resource : qAsConst(focusResources))
+        send_motion(resource->handle, pendingMotionTime, x, y);
+}
+
+// Flushes the pending motion for a frame that started on the pointer's output.
+// With the threaded render loop this is called on the render thread, which
+// must neither touch the timer nor send events, so the flush is left to the
+// pointer's own thread by firing the timer there right away.
+void QWaylandPointerPrivate::frameStarted()
+{
+    Q_Q(QWaylandPointer);
+    if (QThread::currentThread() == q->thread())
+        sendPendingMotion();
+    else
+        QMetaObject::invokeMethod(&motionTimer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
 }
 
 uint QWaylandPointerPrivate::sendButton(Qt::MouseButton button, uint32_t state)
 {
     Q_Q(QWaylandPointer);
+    sendPendingMotion();
     uint32_t time = compositor()->currentTimeMsecs();
     uint32_t serial = compositor()->nextSerial();
-    for (auto resource : pointerResourcesForFocusedSurface())
+    for (Resource *resource : qAsConst(focusResources))
         send_button(resource->handle, serial, time, q->toWaylandButton(button), state);
     return serial;
 }
 
+void QWaylandPointerPrivate::pointer_destroy_resource(Resource *resource)
+{
+    focusResources.removeOne(resource);
+}
+
 void QWaylandPointerPrivate::pointer_release(wl_pointer::Resource *resource)
 {
     wl_resource_destroy(resource->handle);
@@ -124,6 +165,8 @@ QWaylandPointer::QWaylandPointer(QWaylandSeat *seat, QObject *parent)
 {
     connect(&d_func()->focusDestroyListener, &QWaylandDestroyListener::fired, this, &QWaylandPointer::focusDestroyed);
     connect(seat, &QWaylandSeat::mouseFocusChanged, this, &QWaylandPointer::pointerFocusChanged);
+    // In case nothing tells the output that a frame has started
+    connect(&d_func()->motionTimer, &QTimer::timeout, this, [this]() { d_func()->sendPendingMotion(); });
 }
 
 /*!
@@ -234,7 +277,7 @@ void QWaylandPointer::sendMouseMoveEvent(QWaylandView *view, const QPointF &loca
         QWaylandKeyboard *keyboard = d->seat->keyboard();
         if (keyboard)
             keyboard->sendKeyModifiers(view->surface()->client(), d->enterSerial);
-        for (auto resource : d->pointerResourcesForFocusedSurface()) {
+        for (QWaylandPointerPrivate::Resource *resource : qAsConst(d->focusResources)) {
             d->send_enter(resource->handle, d->enterSerial, view->surface()->resource(),
                           wl_fixed_from_double(d->localPosition.x()),
                           wl_fixed_from_double(d->localPosition.y()));
@@ -246,13 +289,13 @@ void QWaylandPointer::sendMouseMoveEvent(QWaylandView *view, const QPointF &loca
     if (view && view->output())
         setOutput(view->output());
 
-    uint32_t time = d->compositor()->currentTimeMsecs();
-
     if (d->seat->mouseFocus()) {
-        wl_fixed_t x = wl_fixed_from_double(currentLocalPosition().x());
-        wl_fixed_t y = wl_fixed_from_double(currentLocalPosition().y());
-        for (auto resource : d->pointerResourcesForFocusedSurface())
-            wl_pointer_send_motion(resource->handle, time, x, y);
+        d->pendingMotionTime = d->compositor()->currentTimeMsecs();
+        if (!d->hasPendingMotion) {
+            d->hasPendingMotion = true;
+            const int refreshRate = d->output ? d->output->currentMode().refreshRate() : 0;
+            d->motionTimer.start(refreshRate > 0 ? qMax(1, 1000000 / refreshRate) : 16);
+        }
     }
 }
 
@@ -265,11 +308,13 @@ void QWaylandPointer::sendMouseWheelEvent(Qt::Orientation orientation, int delta
     if (!d->seat->mouseFocus())
         return;
 
+    d->sendPendingMotion();
+
     uint32_t time = d->compositor()->currentTimeMsecs();
     uint32_t axis = orientation == Qt::Horizontal ? WL_POINTER_AXIS_HORIZONTAL_SCROLL
                                                   : WL_POINTER_AXIS_VERTICAL_SCROLL;
 
-    for (auto resource : d->pointerResourcesForFocusedSurface())
+    for (QWaylandPointerPrivate::Resource *resource : qAsConst(d->focusResources))
         d->send_axis(resource->handle, time, axis, wl_fixed_from_int(-delta / 12));
 }
 
@@ -315,9 +360,11 @@ bool QWaylandPointer::isButtonPressed() const
 void QWaylandPointer::addClient(QWaylandClient *client, uint32_t id, uint32_t version)
 {
     Q_D(QWaylandPointer);
-    wl_resource *resource = d->add(client->client(), id, qMin<uint32_t>(QtWaylandServer::wl_pointer::interfaceVersion(), version))->handle;
+    QWaylandPointerPrivate::Resource *pointerResource = d->add(client->client(), id, qMin<uint32_t>(QtWaylandServer::wl_pointer::interfaceVersion(), version));
+    wl_resource *resource = pointerResource->handle;
     QWaylandView *focus = d->seat->mouseFocus();
     if (focus && client == focus->surface()->client()) {
+        d->focusResources.append(pointerResource);
         d->send_enter(resource, d->enterSerial, focus->surfaceResource(),
                       wl_fixed_from_double(d->localPosition.x()),
                       wl_fixed_from_double(d->localPosition.y()));
@@ -395,6 +442,10 @@ void QWaylandPointer::focusDestroyed(void *data)
     Q_UNUSED(data)
     d->focusDestroyListener.reset();
 
+    // Don't send motion for a surface that is gone
+    d->hasPendingMotion = false;
+    d->motionTimer.stop();
+
     d->seat->setMouseFocus(Q_NULLPTR);
     d->buttonCount = 0;
 }
@@ -406,14 +457,16 @@ void QWaylandPointer::pointerFocusChanged(QWaylandView *newFocus, QWaylandView *
 {
     Q_UNUSED(newFocus);
     Q_D(QWaylandPointer);
+    d->sendPendingMotion();
     d->localPosition = QPointF();
     d->hasSentEnter = false;
     if (oldFocus) {
         uint32_t serial = d->compositor()->nextSerial();
-        for (auto resource : d->resourceMap().values(oldFocus->surfaceResource()->client))
+        for (QWaylandPointerPrivate::Resource *resource : qAsConst(d->focusResources))
             d->send_leave(resource->handle, serial, oldFocus->surfaceResource());
         d->focusDestroyListener.reset();
     }
+    d->updateFocusResources();
 }
 
 QT_END_NAMESPACE
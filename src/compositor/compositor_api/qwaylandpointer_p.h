@@ -56,9 +56,10 @@
 #include <QtWaylandCompositor/QWaylandDestroyListener>
 #include <QtWaylandCompositor/QWaylandPointer>
 
-#include <QtCore/QList>
+#include <QtCore/QVector>
 #include <QtCore/QPoint>
 #include <QtCore/QObject>
+#include <QtCore/QTimer>
 #include <QtCore/private/qobject_p.h>
 
 #include <QtWaylandCompositor/private/qwayland-server-wayland.h>
@@ -81,12 +82,18 @@ public:
 
     QWaylandCompositor *compositor() const { return seat->compositor(); }
 
+    static QWaylandPointerPrivate *get(QWaylandPointer *pointer) { return pointer->d_func(); }
+
+    void sendPendingMotion();
+    void frameStarted();
+
 protected:
     void pointer_set_cursor(Resource *resource, uint32_t serial, wl_resource *surface, int32_t hotspot_x, int32_t hotspot_y) override;
     void pointer_release(Resource *resource) override;
+    void pointer_destroy_resource(Resource *resource) override;
 
 private:
-    const QList<Resource *> pointerResourcesForFocusedSurface() const;
+    void updateFocusResources();
     uint sendButton(Qt::MouseButton button, uint32_t state);
 
     QWaylandSeat *seat;
@@ -100,6 +107,13 @@ private:
 
     int buttonCount;
 
+    // The pointer resources of the client with mouse focus
+    QVector<Resource *> focusResources;
+
+    bool hasPendingMotion;
+    uint32_t pendingMotionTime;
+    QTimer motionTimer;
+
     QWaylandDestroyListener focusDestroyListener;
 
     static QWaylandSurfaceRole s_role;
@@ -62,6 +62,7 @@
 
 #include <QtCore/QMutexLocker>
 #include <QtCore/QMutex>
+#include <QtCore/qmath.h>
 
 #include <wayland-server.h>
 #include <QThread>
@@ -185,6 +186,7 @@ void QWaylandBufferMaterialShader::initialize()
 QWaylandBufferMaterial::QWaylandBufferMaterial(QWaylandBufferRef::BufferFormatEgl format)
     : QSGMaterial()
     , m_format(format)
+    , m_texturesDirty(false)
 {
     QOpenGLFunctions *gl = QOpenGLContext::currentContext()->functions();
 
@@ -214,8 +216,25 @@ void QWaylandBufferMaterial::setTextureForPlane(int plane, QOpenGLTexture *textu
         m_textures[plane] = texture;
 }
 
+// The planes of the buffer are imported when the material is first bound for
+// rendering rather than during sync, so that binding EGLImages to textures
+// doesn't keep the GUI thread blocked. Holding the reference keeps the client
+// from reusing the buffer until we have rendered it.
+void QWaylandBufferMaterial::setBufferRef(const QWaylandBufferRef &ref)
+{
+    m_bufferRef = ref;
+    m_texturesDirty = true;
+}
+
 void QWaylandBufferMaterial::bind()
 {
+    if (m_texturesDirty) {
+        m_texturesDirty = false;
+        for (int plane = 0; plane < bufferTypes[m_format].planeCount; plane++)
+            if (auto texture = m_bufferRef.toOpenGLTexture(plane))
+                setTextureForPlane(plane, texture);
+    }
+
     ensureTextures(bufferTypes[m_format].planeCount);
 
     switch (m_textures.size()) {
@@ -267,6 +286,7 @@ public:
     QWaylandSurfaceTextureProvider()
         : m_smooth(false)
         , m_sgTex(0)
+        , m_reusable(false)
     {
     }
 
@@ -280,8 +300,32 @@ public:
     {
         Q_ASSERT(QThread::currentThread() == thread());
         m_ref = buffer;
+        QOpenGLTexture *shmTexture = nullptr;
+        if (m_ref.hasBuffer() && buffer.isSharedMemory() && QOpenGLContext::currentContext())
+            shmTexture = buffer.toOpenGLTexture();
+        const bool opaque = surfaceItem->surface() && surfaceItem->surface()->isOpaque();
+
+        if (shmTexture) {
+            // The buffer keeps its own texture up to date with only the damaged
+            // parts, so wrap that one instead of uploading another copy. The
+            // wrapper can be kept as long as it still describes the same texture.
+            const QSize size(shmTexture->width(), shmTexture->height());
+            const bool hasAlpha = shmTexture->format() == QOpenGLTexture::RGBAFormat && !opaque;
+            if (!m_reusable || !m_sgTex || m_sgTex->textureId() != int(shmTexture->textureId())
+                    || m_sgTex->textureSize() != size || m_sgTex->hasAlphaChannel() != hasAlpha) {
+                delete m_sgTex;
+                m_sgTex = surfaceItem->window()->createTextureFromId(shmTexture->textureId(), size,
+                                                                     hasAlpha ? QQuickWindow::TextureHasAlphaChannel
+                                                                              : QQuickWindow::CreateTextureOptions());
+                m_reusable = true;
+            }
+            emit textureChanged();
+            return;
+        }
+
         delete m_sgTex;
         m_sgTex = 0;
+        m_reusable = false;
         if (m_ref.hasBuffer()) {
             if (buffer.isSharedMemory()) {
                 m_sgTex = surfaceItem->window()->createTextureFromImage(buffer.image());
@@ -291,7 +335,7 @@ public:
             } else {
                 QQuickWindow::CreateTextureOptions opt = QQuickWindow::TextureOwnsGLTexture;
                 QWaylandQuickSurface *surface = qobject_cast<QWaylandQuickSurface *>(surfaceItem->surface());
-                if (surface && surface->useTextureAlpha()) {
+                if (surface && surface->useTextureAlpha() && !opaque) {
                     opt |= QQuickWindow::TextureHasAlphaChannel;
                 }
 
@@ -313,6 +357,7 @@ public:
 private:
     bool m_smooth;
     QSGTexture *m_sgTex;
+    bool m_reusable;
     QWaylandBufferRef m_ref;
 };
 
@@ -865,6 +910,7 @@ void QWaylandQuickItem::handleSurfaceChanged()
         disconnect(d->oldSurface, &QWaylandSurface::configure, this, &QWaylandQuickItem::updateBuffer);
         disconnect(d->oldSurface, &QWaylandSurface::redraw, this, &QQuickItem::update);
         disconnect(d->oldSurface, &QWaylandSurface::childAdded, this, &QWaylandQuickItem::handleSubsurfaceAdded);
+        disconnect(d->oldSurface, &QWaylandSurface::opaqueRegionChanged, this, &QWaylandQuickItem::handleOpaqueRegionChanged);
 #if QT_CONFIG(draganddrop)
         disconnect(d->oldSurface, &QWaylandSurface::dragStarted, this, &QWaylandQuickItem::handleDragStarted);
 #endif
@@ -880,6 +926,7 @@ void QWaylandQuickItem::handleSurfaceChanged()
         connect(newSurface, &QWaylandSurface::configure, this, &QWaylandQuickItem::updateBuffer);
         connect(newSurface, &QWaylandSurface::redraw, this, &QQuickItem::update);
         connect(newSurface, &QWaylandSurface::childAdded, this, &QWaylandQuickItem::handleSubsurfaceAdded);
+        connect(newSurface, &QWaylandSurface::opaqueRegionChanged, this, &QWaylandQuickItem::handleOpaqueRegionChanged);
 #if QT_CONFIG(draganddrop)
         connect(newSurface, &QWaylandSurface::dragStarted, this, &QWaylandQuickItem::handleDragStarted);
 #endif
@@ -1093,6 +1140,7 @@ void QWaylandQuickItem::setPaintEnabled(bool enabled)
     Q_D(QWaylandQuickItem);
     d->paintEnabled = enabled;
     update();
+    d->updateViewVisibility();
 }
 
 bool QWaylandQuickItem::touchEventsEnabled() const
@@ -1121,13 +1169,23 @@ void QWaylandQuickItem::updateWindow()
 
     if (d->connectedWindow) {
         disconnect(d->connectedWindow, &QQuickWindow::beforeSynchronizing, this, &QWaylandQuickItem::beforeSync);
+        disconnect(d->windowVisibilityConnection);
+        disconnect(d->afterAnimatingConnection);
     }
 
     d->connectedWindow = newWindow;
 
     if (d->connectedWindow) {
         connect(d->connectedWindow, &QQuickWindow::beforeSynchronizing, this, &QWaylandQuickItem::beforeSync, Qt::DirectConnection);
+        d->windowVisibilityConnection = connect(d->connectedWindow, &QWindow::visibilityChanged,
+                                                this, [d]() { d->updateViewVisibility(); });
+        // Whether the item is covered can change with anything in the scene
+        // (stacking, reparenting, layers and effects on the items above), so
+        // it is evaluated again for every frame, before the sync.
+        d->afterAnimatingConnection = connect(d->connectedWindow, &QQuickWindow::afterAnimating,
+                                              this, [d]() { d->updateOcclusion(); });
     }
+    d->updateViewVisibility();
 
     if (compositor() && d->connectedWindow) {
         QWaylandOutput *output = compositor()->outputFor(d->connectedWindow);
@@ -1164,7 +1222,7 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
     if (d->view->isBufferLocked() && !bufferHasContent && d->paintEnabled)
         return oldNode;
 
-    if (!bufferHasContent || !d->paintEnabled) {
+    if (!bufferHasContent || !d->paintEnabled || d->occluded) {
         delete oldNode;
         return 0;
     }
@@ -1217,12 +1275,12 @@ QSGNode *QWaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeDat
 
         if (d->newTexture) {
             d->newTexture = false;
-            for (int plane = 0; plane < bufferTypes[ref.bufferFormatEgl()].planeCount; plane++)
-                if (auto texture = ref.toOpenGLTexture(plane))
-                    material->setTextureForPlane(plane, texture);
-            material->bind();
+            material->setBufferRef(ref);
         }
 
+        // Blending is only needed where the client said the surface may be translucent.
+        material->setFlag(QSGMaterial::Blending, !surface() || !surface()->isOpaque());
+
         QSGGeometry::updateTexturedRectGeometry(geometry, rect, QRectF(0, 0, 1, 1));
 
         node->setGeometry(geometry);
@@ -1292,6 +1350,19 @@ void QWaylandQuickItem::handleSubsurfacePosition(const QPoint &pos)
     QQuickItem::setPosition(pos * d->scaleFactor());
 }
 
+/*!
+ * \internal
+ *
+ * Picks up the new opaque region of the surface for blending this item. The
+ * items stacked below it are culled again with the next frame.
+ */
+void QWaylandQuickItem::handleOpaqueRegionChanged()
+{
+    Q_D(QWaylandQuickItem);
+    d->newTexture = true;
+    update();
+}
+
 #if QT_CONFIG(draganddrop)
 void QWaylandQuickItem::handleDragStarted(QWaylandDrag *drag)
 {
@@ -1308,4 +1379,103 @@ qreal QWaylandQuickItemPrivate::scaleFactor() const
             / (window ? window->devicePixelRatio() : 1);
 }
 
+// Returns the part of \a item that is guaranteed to be painted fully opaque,
+// in the coordinate system of its parent item.
+static QRegion opaqueRegionInParent(QWaylandQuickItem *item)
+{
+    QWaylandSurface *surface = item->surface();
+    if (!surface || !surface->hasContent() || !item->isVisible() || !item->isPaintEnabled()
+            || item->opacity() < 1.0 || item->rotation() != 0)
+        return QRegion();
+
+    // Items with a layer or used by an effect may be drawn elsewhere, or not at all.
+    const QQuickItemPrivate *itemPrivate = QQuickItemPrivate::get(item);
+    if (!itemPrivate->transforms.isEmpty()
+            || (itemPrivate->extra.isAllocated()
+                && (itemPrivate->extra->effectRefCount > 0 || itemPrivate->extra->hideRefCount > 0)))
+        return QRegion();
+
+    const QRegion opaqueRegion = surface->opaqueRegion();
+    const QSize surfaceSize = surface->size();
+    if (opaqueRegion.isEmpty() || surfaceSize.isEmpty())
+        return QRegion();
+
+    const qreal sx = item->width() / surfaceSize.width();
+    const qreal sy = item->height() / surfaceSize.height();
+    const bool invertY = surface->origin() == QWaylandSurface::OriginBottomLeft;
+
+    QRegion region;
+    for (const QRect &rect : opaqueRegion) {
+        QRectF r(rect.x() * sx, rect.y() * sy, rect.width() * sx, rect.height() * sy);
+        if (invertY)
+            r.moveBottom(item->height() - r.top());
+        r = item->mapRectToItem(item->parentItem(), r);
+        // Round inwards, pixels that are only partially covered still show what is below.
+        const QRect inner(QPoint(qCeil(r.left()), qCeil(r.top())),
+                          QPoint(qFloor(r.right()) - 1, qFloor(r.bottom()) - 1));
+        if (inner.isValid())
+            region += inner;
+    }
+    return region;
+}
+
+/*
+ * Returns true if this item is completely hidden behind the opaque regions of
+ * the QWaylandQuickItems stacked above it in the same parent, so that it does
+ * not need to be rendered at all.
+ */
+bool QWaylandQuickItemPrivate::isOccluded() const
+{
+    Q_Q(const QWaylandQuickItem);
+    QQuickItem *parent = q->parentItem();
+    // Someone may be using this item as the source of an effect.
+    if (!parent || (extra.isAllocated() && extra->effectRefCount > 0))
+        return false;
+
+    const QList<QQuickItem *> siblings = QQuickItemPrivate::get(parent)->paintOrderChildItems();
+    const int index = siblings.indexOf(const_cast<QWaylandQuickItem *>(q));
+    if (index < 0)
+        return false;
+
+    QRegion uncovered(q->mapRectToItem(parent, QRectF(0, 0, q->width(), q->height())).toAlignedRect());
+    for (int i = index + 1; i < siblings.size() && !uncovered.isEmpty(); ++i) {
+        if (QWaylandQuickItem *above = qobject_cast<QWaylandQuickItem *>(siblings.at(i)))
+            uncovered -= opaqueRegionInParent(above);
+    }
+    return uncovered.isEmpty();
+}
+
+/*
+ * Evaluates again whether this item is covered, and schedules a repaint when
+ * that changed so that its node is dropped or created again.
+ */
+void QWaylandQuickItemPrivate::updateOcclusion()
+{
+    Q_Q(QWaylandQuickItem);
+    const bool nowOccluded = isOccluded();
+    if (nowOccluded != occluded) {
+        occluded = nowOccluded;
+        q->update();
+    }
+    updateViewVisibility();
+}
+
+/*
+ * Tells the view whether the user can currently see this item, which lets the
+ * output throttle frame callbacks for surfaces that are hidden or covered.
+ * Ancestors are checked again on every frame through updateOcclusion().
+ */
+void QWaylandQuickItemPrivate::updateViewVisibility()
+{
+    Q_Q(QWaylandQuickItem);
+    QQuickWindow *window = q->window();
+    // isVisible() already covers hidden ancestors
+    bool visible = q->isVisible() && paintEnabled && !occluded
+            && window && window->isVisible() && window->visibility() != QWindow::Minimized;
+    // A fully transparent ancestor hides the item as well
+    for (QQuickItem *item = q; visible && item; item = item->parentItem())
+        visible = item->opacity() > 0;
+    view->setVisible(visible);
+}
+
 QT_END_NAMESPACE
@@ -162,6 +162,7 @@ private Q_SLOTS:
     void beforeSync();
     void handleSubsurfaceAdded(QWaylandSurface *childSurface);
     void handleSubsurfacePosition(const QPoint &pos);
+    void handleOpaqueRegionChanged();
 #if QT_CONFIG(draganddrop)
     void handleDragStarted(QWaylandDrag *drag);
 #endif
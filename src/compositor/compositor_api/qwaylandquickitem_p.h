@@ -89,6 +89,7 @@ public:
     ~QWaylandBufferMaterial();
 
     void setTextureForPlane(int plane, QOpenGLTexture *texture);
+    void setBufferRef(const QWaylandBufferRef &ref);
 
     void bind();
 
@@ -101,6 +102,8 @@ private:
 
     const QWaylandBufferRef::BufferFormatEgl m_format;
     QVarLengthArray<QOpenGLTexture*, 3> m_textures;
+    QWaylandBufferRef m_bufferRef;
+    bool m_texturesDirty;
 };
 
 class QWaylandQuickItemPrivate : public QQuickItemPrivate
@@ -117,6 +120,7 @@ public:
         , inputEventsEnabled(true)
         , isDragging(false)
         , newTexture(false)
+        , occluded(false)
         , focusOnClick(true)
         , sizeFollowsSurface(true)
         , connectedWindow(Q_NULLPTR)
@@ -163,6 +167,9 @@ public:
 
     bool shouldSendInputEvents() const { return view->surface() && inputEventsEnabled; }
     qreal scaleFactor() const;
+    bool isOccluded() const;
+    void updateOcclusion();
+    void updateViewVisibility();
 
     static QMutex *mutex;
 
@@ -174,11 +181,14 @@ public:
     bool inputEventsEnabled;
     bool isDragging;
     bool newTexture;
+    bool occluded;
     bool focusOnClick;
     bool sizeFollowsSurface;
     QPoint hoverPos;
 
     QQuickWindow *connectedWindow;
+    QMetaObject::Connection windowVisibilityConnection;
+    QMetaObject::Connection afterAnimatingConnection;
     QWaylandSurface::Origin origin;
     QPointer<QObject> subsurfaceHandler;
     QVector<QWaylandSeat *> touchingSeats;
@@ -142,11 +142,15 @@ QWaylandSurfacePrivate::QWaylandSurfacePrivate()
     , inputMethodControl(Q_NULLPTR)
 #endif
     , subsurface(0)
+    , frameCallbackSent(false)
+    , lastFrameCallbackTime(0)
 {
     pending.buffer = QWaylandBufferRef();
     pending.newlyAttached = false;
     pending.inputRegion = infiniteRegion();
     pending.bufferScale = 1;
+    cached = pending;
+    hasCachedState = false;
 #ifndef QT_NO_DEBUG
     addUninitializedSurface(this);
 #endif
@@ -161,7 +165,16 @@ QWaylandSurfacePrivate::~QWaylandSurfacePrivate()
 
     bufferRef = QWaylandBufferRef();
 
-    foreach (QtWayland::FrameCallback *c, pendingFrameCallbacks)
+    if (QWaylandSurfacePrivate *parent = parentSurface())
+        parent->subsurfaceChildren.removeOne(this);
+    if (subsurface)
+        subsurface->surface = nullptr;
+    foreach (QWaylandSurfacePrivate *child, subsurfaceChildren)
+        child->subsurface->parentSurface = nullptr;
+
+    foreach (QtWayland::FrameCallback *c, pending.frameCallbacks)
+        c->destroy();
+    foreach (QtWayland::FrameCallback *c, cached.frameCallbacks)
         c->destroy();
     foreach (QtWayland::FrameCallback *c, frameCallbacks)
         c->destroy();
@@ -171,7 +184,6 @@ void QWaylandSurfacePrivate::setSize(const QSize &s)
 {
     Q_Q(QWaylandSurface);
     if (size != s) {
-        opaqueRegion = QRegion();
         size = s;
         q->sizeChanged();
     }
@@ -188,10 +200,29 @@ void QWaylandSurfacePrivate::setBufferScale(int scale)
 
 void QWaylandSurfacePrivate::removeFrameCallback(QtWayland::FrameCallback *callback)
 {
-    pendingFrameCallbacks.removeOne(callback);
+    pending.frameCallbacks.removeOne(callback);
+    cached.frameCallbacks.removeOne(callback);
     frameCallbacks.removeOne(callback);
 }
 
+bool QWaylandSurfacePrivate::hasFrameCallbacksToSend() const
+{
+    for (QtWayland::FrameCallback *callback : frameCallbacks) {
+        if (callback->canSend)
+            return true;
+    }
+    return false;
+}
+
+bool QWaylandSurfacePrivate::hasVisibleView() const
+{
+    for (QWaylandView *view : views) {
+        if (view->isVisible())
+            return true;
+    }
+    return false;
+}
+
 void QWaylandSurfacePrivate::notifyViewsAboutDestruction()
 {
     Q_Q(QWaylandSurface);
@@ -256,12 +287,12 @@ void QWaylandSurfacePrivate::surface_frame(Resource *resource, uint32_t callback
 {
     Q_Q(QWaylandSurface);
     struct wl_resource *frame_callback = wl_resource_create(resource->client(), &wl_callback_interface, wl_callback_interface.version, callback);
-    pendingFrameCallbacks << new QtWayland::FrameCallback(q, frame_callback);
+    pending.frameCallbacks << new QtWayland::FrameCallback(q, frame_callback);
 }
 
 void QWaylandSurfacePrivate::surface_set_opaque_region(Resource *, struct wl_resource *region)
 {
-    opaqueRegion = region ? QtWayland::Region::fromResource(region)->region() : QRegion();
+    pending.opaqueRegion = region ? QtWayland::Region::fromResource(region)->region() : QRegion();
 }
 
 void QWaylandSurfacePrivate::surface_set_input_region(Resource *, struct wl_resource *region)
@@ -274,18 +305,94 @@ void QWaylandSurfacePrivate::surface_set_input_region(Resource *, struct wl_reso
 }
 
 void QWaylandSurfacePrivate::surface_commit(Resource *)
+{
+    cachePendingState();
+
+    if (!isSynchronized())
+        applyCachedState();
+}
+
+// Adds the pending state on top of what is cached already, as a
+// synchronized subsurface may be committed several times before its
+// parent is.
+void QWaylandSurfacePrivate::cachePendingState()
+{
+    if (pending.buffer.hasBuffer() || pending.newlyAttached) {
+        cached.buffer = pending.buffer;
+        cached.newlyAttached = true;
+    }
+    cached.offset += pending.offset;
+    cached.damage += pending.damage;
+    cached.inputRegion = pending.inputRegion;
+    cached.opaqueRegion = pending.opaqueRegion;
+    cached.bufferScale = pending.bufferScale;
+    cached.frameCallbacks << pending.frameCallbacks;
+    hasCachedState = true;
+
+    pending.buffer = QWaylandBufferRef();
+    pending.offset = QPoint();
+    pending.newlyAttached = false;
+    pending.damage = QRegion();
+    pending.frameCallbacks.clear();
+}
+
+/*
+ * Records commitDamage, in buffer coordinates, for a commit of buffer and
+ * returns the damage relative to the buffer's own previous contents. That is
+ * the damage of every commit since the buffer was last committed to this
+ * surface, or all of it when that is no longer known.
+ */
+QRegion QWaylandSurfacePrivate::commitBufferDamage(QtWayland::ClientBuffer *buffer, const QRegion &commitDamage)
+{
+    int last = damageHistory.size() - 1;
+    while (last >= 0 && damageHistory.at(last).serial != buffer->commitSerial())
+        --last;
+    QRegion bufferDamage;
+    if (last < 0) {
+        bufferDamage = QRect(QPoint(), buffer->size());
+    } else {
+        bufferDamage = commitDamage;
+        for (int i = last + 1; i < damageHistory.size(); ++i)
+            bufferDamage += damageHistory.at(i).damage;
+    }
+
+    // Serials are unique across surfaces, so a buffer moved to another
+    // surface is never matched against the wrong history
+    static quint64 lastCommitSerial = 0;
+    const CommitDamage commit = { ++lastCommitSerial, commitDamage };
+    if (damageHistory.size() == MaxDamageHistory)
+        damageHistory.removeFirst();
+    damageHistory.append(commit);
+    buffer->setCommitSerial(commit.serial);
+
+    return bufferDamage;
+}
+
+void QWaylandSurfacePrivate::applyCachedState()
 {
     Q_Q(QWaylandSurface);
 
-    if (pending.buffer.hasBuffer() || pending.newlyAttached)
-        bufferRef = pending.buffer;
+    hasCachedState = false;
+
+    if (cached.buffer.hasBuffer() || cached.newlyAttached)
+        bufferRef = cached.buffer;
 
     auto buffer = bufferRef.buffer();
-    if (buffer)
-        buffer->setCommitted(pending.damage);
+    if (buffer) {
+        QRegion commitDamage;
+        if (cached.bufferScale == 1) {
+            commitDamage = cached.damage;
+        } else {
+            for (const QRect &rect : cached.damage)
+                commitDamage += QRect(rect.topLeft() * cached.bufferScale, rect.size() * cached.bufferScale);
+        }
+
+        QRegion bufferDamage = commitBufferDamage(buffer, commitDamage);
+        buffer->setCommitted(bufferDamage);
+    }
 
     setSize(bufferRef.size());
-    damage = pending.damage.intersected(QRect(QPoint(), size));
+    damage = cached.damage.intersected(QRect(QPoint(), size));
 
     for (int i = 0; i < views.size(); i++) {
         views.at(i)->bufferCommitted(bufferRef, damage);
@@ -298,25 +405,78 @@ void QWaylandSurfacePrivate::surface_commit(Resource *)
     if (oldHasContent != hasContent)
         emit q->hasContentChanged();
 
-    if (!pending.offset.isNull())
-        emit q->offsetForNextFrame(pending.offset);
+    if (!cached.offset.isNull())
+        emit q->offsetForNextFrame(cached.offset);
 
-    setBufferScale(pending.bufferScale);
+    setBufferScale(cached.bufferScale);
 
 
-    pending.buffer = QWaylandBufferRef();
-    pending.offset = QPoint();
-    pending.newlyAttached = false;
-    pending.damage = QRegion();
+    cached.buffer = QWaylandBufferRef();
+    cached.offset = QPoint();
+    cached.newlyAttached = false;
+    cached.damage = QRegion();
 
-    frameCallbacks << pendingFrameCallbacks;
-    pendingFrameCallbacks.clear();
+    frameCallbacks << cached.frameCallbacks;
+    cached.frameCallbacks.clear();
 
-    inputRegion = pending.inputRegion.intersected(QRect(QPoint(), size));
+    inputRegion = cached.inputRegion.intersected(QRect(QPoint(), size));
+
+    QRegion oldOpaqueRegion = opaqueRegion;
+    opaqueRegion = cached.opaqueRegion.intersected(QRect(QPoint(), size));
+    if (opaqueRegion != oldOpaqueRegion)
+        emit q->opaqueRegionChanged();
+
+    // Subsurface positions are part of the parent's state, and synchronized
+    // subsurfaces get updated together with their parent.
+    foreach (QWaylandSurfacePrivate *child, subsurfaceChildren) {
+        Subsurface *childSubsurface = child->subsurface;
+        if (childSubsurface->hasPendingPosition) {
+            childSubsurface->hasPendingPosition = false;
+            if (childSubsurface->position != childSubsurface->pendingPosition) {
+                childSubsurface->position = childSubsurface->pendingPosition;
+                emit child->q_func()->subsurfacePositionChanged(childSubsurface->position);
+            }
+        }
+        if (child->hasCachedState && child->isSynchronized())
+            child->applyCachedState();
+    }
 
     emit q->redraw();
 }
 
+// Applies what was cached by descendants that are no longer kept
+// synchronized by any of their ancestors.
+void QWaylandSurfacePrivate::applyDesynchronizedSubsurfaces()
+{
+    foreach (QWaylandSurfacePrivate *child, subsurfaceChildren) {
+        if (child->isSynchronized())
+            continue;
+        if (child->hasCachedState)
+            child->applyCachedState();
+        child->applyDesynchronizedSubsurfaces();
+    }
+}
+
+// Called when the client destroys the wl_subsurface. The surface stops
+// being a subsurface right away, so whatever it had cached is applied.
+void QWaylandSurfacePrivate::subsurfaceDestroyed()
+{
+    Q_Q(QWaylandSurface);
+    QWaylandSurfacePrivate *parent = parentSurface();
+    if (parent)
+        parent->subsurfaceChildren.removeOne(this);
+    subsurface = nullptr;
+
+    if (!destroyed) {
+        if (hasCachedState)
+            applyCachedState();
+        applyDesynchronizedSubsurfaces();
+    }
+
+    if (parent)
+        emit q->parentChanged(nullptr, parent->q_func());
+}
+
 void QWaylandSurfacePrivate::surface_set_buffer_transform(Resource *resource, int32_t orientation)
 {
     Q_UNUSED(resource);
@@ -481,6 +641,41 @@ bool QWaylandSurface::hasContent() const
     return d->hasContent;
 }
 
+/*!
+ * Returns the region of the QWaylandSurface that the client has marked as
+ * opaque, in surface coordinates. Content below this region doesn't need to
+ * be drawn, and the region can be drawn without blending.
+ *
+ * \since 5.10
+ * \sa isOpaque()
+ */
+QRegion QWaylandSurface::opaqueRegion() const
+{
+    Q_D(const QWaylandSurface);
+    return d->opaqueRegion;
+}
+
+/*!
+ * \qmlproperty bool QtWaylandCompositor::WaylandSurface::opaque
+ * \since 5.10
+ *
+ * This property holds whether the client has marked the entire WaylandSurface as opaque.
+ */
+
+/*!
+ * \property QWaylandSurface::opaque
+ * \since 5.10
+ *
+ * This property holds whether the client has marked the entire QWaylandSurface as opaque.
+ *
+ * \sa opaqueRegion()
+ */
+bool QWaylandSurface::isOpaque() const
+{
+    Q_D(const QWaylandSurface);
+    return !d->size.isEmpty() && d->opaqueRegion == QRegion(QRect(QPoint(), d->size));
+}
+
 /*!
  * \qmlproperty size QtWaylandCompositor::WaylandSurface::size
  *
@@ -606,6 +801,8 @@ void QWaylandSurface::sendFrameCallbacks()
             d->frameCallbacks.at(i)->surface = Q_NULLPTR;
             d->frameCallbacks.at(i)->send(time);
             d->frameCallbacks.removeAt(i);
+            d->frameCallbackSent = true;
+            d->lastFrameCallbackTime = time;
         } else {
             i++;
         }
@@ -845,16 +1042,27 @@ void QWaylandSurfacePrivate::initSubsurface(QWaylandSurface *parent, wl_client *
     subsurface = new Subsurface(this);
     subsurface->init(client, id, version);
     subsurface->parentSurface = parent->d_func();
+    subsurface->parentSurface->subsurfaceChildren.append(this);
     emit q->parentChanged(parent, oldParent);
     emit parent->childAdded(q);
 }
 
+// A subsurface behaves as synchronized if it or any of its ancestors is
+bool QWaylandSurfacePrivate::isSynchronized() const
+{
+    for (const QWaylandSurfacePrivate *s = this; s->subsurface && s->subsurface->parentSurface; s = s->subsurface->parentSurface) {
+        if (s->subsurface->synchronized)
+            return true;
+    }
+    return false;
+}
+
 void QWaylandSurfacePrivate::Subsurface::subsurface_set_position(wl_subsurface::Resource *resource, int32_t x, int32_t y)
 {
     Q_UNUSED(resource);
-    position = QPoint(x,y);
-    emit surface->q_func()->subsurfacePositionChanged(position);
-
+    // Applied together with the parent's next state
+    pendingPosition = QPoint(x,y);
+    hasPendingPosition = true;
 }
 
 void QWaylandSurfacePrivate::Subsurface::subsurface_place_above(wl_subsurface::Resource *resource, struct wl_resource *sibling)
@@ -872,15 +1080,38 @@ void QWaylandSurfacePrivate::Subsurface::subsurface_place_below(wl_subsurface::R
 void QWaylandSurfacePrivate::Subsurface::subsurface_set_sync(wl_subsurface::Resource *resource)
 {
     Q_UNUSED(resource);
-    // TODO: sync/desync implementation
-    qDebug() << Q_FUNC_INFO;
+    synchronized = true;
 }
 
 void QWaylandSurfacePrivate::Subsurface::subsurface_set_desync(wl_subsurface::Resource *resource)
 {
     Q_UNUSED(resource);
-    // TODO: sync/desync implementation
-    qDebug() << Q_FUNC_INFO;
+    if (!synchronized)
+        return;
+
+    synchronized = false;
+
+    // Whatever was cached while synchronized shows up right away now, also
+    // for descendants this surface was keeping synchronized, unless an
+    // ancestor still keeps the surface synchronized
+    if (surface->isSynchronized())
+        return;
+    if (surface->hasCachedState)
+        surface->applyCachedState();
+    surface->applyDesynchronizedSubsurfaces();
+}
+
+void QWaylandSurfacePrivate::Subsurface::subsurface_destroy(wl_subsurface::Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void QWaylandSurfacePrivate::Subsurface::subsurface_destroy_resource(wl_subsurface::Resource *resource)
+{
+    Q_UNUSED(resource);
+    if (surface)
+        surface->subsurfaceDestroyed();
+    delete this;
 }
 
 /*!
@@ -86,6 +86,7 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandSurface : public QWaylandObject
     Q_PROPERTY(Qt::ScreenOrientation contentOrientation READ contentOrientation NOTIFY contentOrientationChanged)
     Q_PROPERTY(QWaylandSurface::Origin origin READ origin NOTIFY originChanged)
     Q_PROPERTY(bool hasContent READ hasContent NOTIFY hasContentChanged)
+    Q_PROPERTY(bool opaque READ isOpaque NOTIFY opaqueRegionChanged)
     Q_PROPERTY(bool cursorSurface READ isCursorSurface WRITE markAsCursorSurface)
 
 public:
@@ -120,6 +121,8 @@ public:
     QWaylandCompositor *compositor() const;
 
     bool inputRegionContains(const QPoint &p) const;
+    QRegion opaqueRegion() const;
+    bool isOpaque() const;
 
     Q_INVOKABLE void destroy();
     Q_INVOKABLE bool isDestroyed() const;
@@ -152,6 +155,7 @@ protected:
 
 Q_SIGNALS:
     void hasContentChanged();
+    void opaqueRegionChanged();
     void damaged(const QRegion &rect);
     void parentChanged(QWaylandSurface *newParent, QWaylandSurface *oldParent);
     void childAdded(QWaylandSurface *child);
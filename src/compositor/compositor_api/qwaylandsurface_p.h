@@ -106,6 +106,8 @@ public:
     void setBufferScale(int bufferScale);
 
     void removeFrameCallback(QtWayland::FrameCallback *callback);
+    bool hasFrameCallbacksToSend() const;
+    bool hasVisibleView() const;
 
     void notifyViewsAboutDestruction();
 
@@ -118,6 +120,13 @@ public:
     void initSubsurface(QWaylandSurface *parent, struct ::wl_client *client, int id, int version);
     bool isSubsurface() const { return subsurface; }
     QWaylandSurfacePrivate *parentSurface() const { return subsurface ? subsurface->parentSurface : nullptr; }
+    bool isSynchronized() const;
+
+    void cachePendingState();
+    void applyCachedState();
+    QRegion commitBufferDamage(QtWayland::ClientBuffer *buffer, const QRegion &commitDamage);
+    void applyDesynchronizedSubsurfaces();
+    void subsurfaceDestroyed();
 
 protected:
     void surface_destroy_resource(Resource *resource) override;
@@ -148,20 +157,39 @@ public: //member variables
     QWaylandBufferRef bufferRef;
     QWaylandSurfaceRole *role;
 
-    struct {
+    // Damage of the last few commits in buffer coordinates, so that a buffer
+    // that comes back can be told everything that changed since it was last
+    // committed. Clients usually cycle through two or three buffers.
+    struct CommitDamage {
+        quint64 serial;
+        QRegion damage;
+    };
+    enum { MaxDamageHistory = 4 };
+    QVector<CommitDamage> damageHistory;
+
+    struct SurfaceState {
         QWaylandBufferRef buffer;
         QRegion damage;
         QPoint offset;
         bool newlyAttached;
         QRegion inputRegion;
+        QRegion opaqueRegion;
         int bufferScale;
-    } pending;
+        QList<QtWayland::FrameCallback *> frameCallbacks;
+    };
+
+    // Committed state is cached first, and only applied once the surface
+    // isn't a synchronized subsurface anymore or its parent gets applied.
+    SurfaceState pending;
+    SurfaceState cached;
+    bool hasCachedState;
 
     QPoint lastLocalMousePos;
     QPoint lastGlobalMousePos;
 
-    QList<QtWayland::FrameCallback *> pendingFrameCallbacks;
     QList<QtWayland::FrameCallback *> frameCallbacks;
+    bool frameCallbackSent;
+    uint lastFrameCallbackTime;
 
     QRegion inputRegion;
     QRegion opaqueRegion;
@@ -181,7 +209,12 @@ public: //member variables
     class Subsurface : public QtWaylandServer::wl_subsurface
     {
     public:
-        Subsurface(QWaylandSurfacePrivate *s) : surface(s) {}
+        Subsurface(QWaylandSurfacePrivate *s)
+            : surface(s)
+            , parentSurface(nullptr)
+            , hasPendingPosition(false)
+            , synchronized(true)
+        {}
         QWaylandSurfacePrivate *surfaceFromResource();
 
     protected:
@@ -190,15 +223,21 @@ public: //member variables
         void subsurface_place_below(wl_subsurface::Resource *resource, struct wl_resource *sibling);
         void subsurface_set_sync(wl_subsurface::Resource *resource);
         void subsurface_set_desync(wl_subsurface::Resource *resource);
+        void subsurface_destroy(wl_subsurface::Resource *resource);
+        void subsurface_destroy_resource(wl_subsurface::Resource *resource);
 
     private:
         friend class QWaylandSurfacePrivate;
         QWaylandSurfacePrivate *surface;
         QWaylandSurfacePrivate *parentSurface;
         QPoint position;
+        QPoint pendingPosition;
+        bool hasPendingPosition;
+        bool synchronized;
     };
 
     Subsurface *subsurface;
+    QList<QWaylandSurfacePrivate *> subsurfaceChildren;
 
 #ifndef QT_NO_DEBUG
     static QList<QWaylandSurfacePrivate *> uninitializedSurfaces;
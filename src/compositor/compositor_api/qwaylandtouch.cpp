@@ -61,10 +61,17 @@ void QWaylandTouchPrivate::touch_release(Resource *resource)
     wl_resource_destroy(resource->handle);
 }
 
+// The resource most recently bound by client, looked up in the per-client index
+QtWaylandServer::wl_touch::Resource *QWaylandTouchPrivate::clientResource(struct ::wl_client *client) const
+{
+    const QVector<Resource *> &resources = resourcesForClient(client);
+    return resources.isEmpty() ? nullptr : resources.last();
+}
+
 uint QWaylandTouchPrivate::sendDown(QWaylandSurface *surface, uint32_t time, int touch_id, const QPointF &position)
 {
     Q_Q(QWaylandTouch);
-    auto focusResource = resourceMap().value(surface->client()->client());
+    auto focusResource = clientResource(surface->client()->client());
     if (!focusResource)
         return 0;
 
@@ -77,7 +84,7 @@ uint QWaylandTouchPrivate::sendDown(QWaylandSurface *surface, uint32_t time, int
 
 uint QWaylandTouchPrivate::sendUp(QWaylandClient *client, uint32_t time, int touch_id)
 {
-    auto focusResource = resourceMap().value(client->client());
+    auto focusResource = clientResource(client->client());
 
     if (!focusResource)
         return 0;
@@ -90,7 +97,7 @@ uint QWaylandTouchPrivate::sendUp(QWaylandClient *client, uint32_t time, int tou
 
 void QWaylandTouchPrivate::sendMotion(QWaylandClient *client, uint32_t time, int touch_id, const QPointF &position)
 {
-    auto focusResource = resourceMap().value(client->client());
+    auto focusResource = clientResource(client->client());
 
     if (!focusResource)
         return;
@@ -171,7 +178,7 @@ uint QWaylandTouch::sendTouchPointEvent(QWaylandSurface *surface, int id, const
 void QWaylandTouch::sendFrameEvent(QWaylandClient *client)
 {
     Q_D(QWaylandTouch);
-    auto focusResource = d->resourceMap().value(client->client());
+    auto focusResource = d->clientResource(client->client());
     if (focusResource)
         d->send_frame(focusResource->handle);
 }
@@ -182,7 +189,7 @@ void QWaylandTouch::sendFrameEvent(QWaylandClient *client)
 void QWaylandTouch::sendCancelEvent(QWaylandClient *client)
 {
     Q_D(QWaylandTouch);
-    auto focusResource = d->resourceMap().value(client->client());
+    auto focusResource = d->clientResource(client->client());
     if (focusResource)
         d->send_cancel(focusResource->handle);
 }
@@ -78,6 +78,8 @@ public:
     void sendMotion(QWaylandClient *client, uint32_t time, int touch_id, const QPointF &position);
     uint sendUp(QWaylandClient *client, uint32_t time, int touch_id);
 
+    Resource *clientResource(struct ::wl_client *client) const;
+
 private:
     void touch_release(Resource *resource) override;
 
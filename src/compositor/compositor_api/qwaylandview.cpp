@@ -348,6 +348,48 @@ void QWaylandView::setAllowDiscardFrontBuffer(bool discard)
     emit allowDiscardFrontBufferChanged();
 }
 
+/*!
+ * \qmlproperty bool QtWaylandCompositor::WaylandView::visible
+ * \since 5.10
+ *
+ * This property holds whether the content of this view can currently be seen
+ * by the user. Set it to false when the view is hidden, minimized or fully
+ * covered by other content.
+ *
+ * Surfaces with no visible views receive frame callbacks at the rate set by
+ * WaylandOutput::hiddenFrameCallbackInterval.
+ *
+ * The default is true. WaylandQuickItem updates it automatically.
+ */
+
+/*!
+ * \property QWaylandView::visible
+ * \since 5.10
+ *
+ * This property holds whether the content of this view can currently be seen
+ * by the user. Set it to \c false when the view is hidden, minimized or fully
+ * covered by other content.
+ *
+ * Surfaces with no visible views receive frame callbacks at the rate set by
+ * QWaylandOutput::hiddenFrameCallbackInterval.
+ *
+ * The default is \c true. QWaylandQuickItem updates it automatically.
+ */
+bool QWaylandView::isVisible() const
+{
+    Q_D(const QWaylandView);
+    return d->visible;
+}
+
+void QWaylandView::setVisible(bool visible)
+{
+    Q_D(QWaylandView);
+    if (d->visible == visible)
+        return;
+    d->visible = visible;
+    emit visibleChanged();
+}
+
 /*!
  * Makes this QWaylandView the primary view for the surface.
  *
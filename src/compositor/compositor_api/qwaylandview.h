@@ -61,6 +61,7 @@ class Q_WAYLAND_COMPOSITOR_EXPORT QWaylandView : public QObject
     Q_PROPERTY(QWaylandOutput *output READ output WRITE setOutput NOTIFY outputChanged)
     Q_PROPERTY(bool bufferLocked READ isBufferLocked WRITE setBufferLocked NOTIFY bufferLockedChanged)
     Q_PROPERTY(bool allowDiscardFrontBuffer READ allowDiscardFrontBuffer WRITE setAllowDiscardFrontBuffer NOTIFY allowDiscardFrontBufferChanged)
+    Q_PROPERTY(bool visible READ isVisible WRITE setVisible NOTIFY visibleChanged)
 public:
     QWaylandView(QObject *renderObject = nullptr, QObject *parent = nullptr);
     virtual ~QWaylandView();
@@ -85,6 +86,9 @@ public:
     bool allowDiscardFrontBuffer() const;
     void setAllowDiscardFrontBuffer(bool discard);
 
+    bool isVisible() const;
+    void setVisible(bool visible);
+
     void setPrimary();
     bool isPrimary() const;
 
@@ -96,6 +100,7 @@ Q_SIGNALS:
     void outputChanged();
     void bufferLockedChanged();
     void allowDiscardFrontBufferChanged();
+    void visibleChanged();
 };
 
 QT_END_NAMESPACE
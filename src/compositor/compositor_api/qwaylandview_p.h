@@ -77,6 +77,7 @@ public:
         , broadcastRequestedPositionChanged(false)
         , forceAdvanceSucceed(false)
         , allowDiscardFrontBuffer(false)
+        , visible(true)
     { }
 
     void markSurfaceAsDestroyed(QWaylandSurface *surface);
@@ -95,6 +96,7 @@ public:
     bool broadcastRequestedPositionChanged;
     bool forceAdvanceSucceed;
     bool allowDiscardFrontBuffer;
+    bool visible;
 };
 
 QT_END_NAMESPACE
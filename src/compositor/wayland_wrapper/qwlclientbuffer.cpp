@@ -42,6 +42,7 @@
 #if QT_CONFIG(opengl)
 #include "hardware_integration/qwlclientbufferintegration_p.h"
 #include <qpa/qplatformopenglcontext.h>
+#include <QOpenGLContext>
 #include <QOpenGLTexture>
 #endif
 
@@ -61,6 +62,7 @@ ClientBuffer::ClientBuffer(struct ::wl_resource *buffer)
     , m_textureDirty(false)
     , m_committed(false)
     , m_destroyed(false)
+    , m_commitSerial(0)
 {
 }
 
@@ -119,6 +121,7 @@ SharedMemoryBuffer::SharedMemoryBuffer(wl_resource *bufferResource)
     : ClientBuffer(bufferResource)
 #if QT_CONFIG(opengl)
     , m_shmTexture(nullptr)
+    , m_shmInternalFormat(0)
 #endif
 {
 
@@ -140,7 +143,22 @@ QWaylandSurface::Origin SharedMemoryBuffer::origin() const
 }
 
 
-// TODO: support different color formats, and try to avoid QImage::convertToFormat()
+static QImage::Format imageFormatFromShmFormat(uint32_t shmFormat)
+{
+    // wl_shm buffers with alpha are premultiplied, the helper maps to the
+    // first matching QImage format though
+    switch (shmFormat) {
+    case WL_SHM_FORMAT_ARGB8888:
+        return QImage::Format_ARGB32_Premultiplied;
+    case WL_SHM_FORMAT_ABGR8888:
+        return QImage::Format_RGBA8888_Premultiplied;
+    default:
+        break;
+    }
+
+    QImage::Format format = QWaylandSharedMemoryFormatHelper::fromWaylandShmFormat(wl_shm_format(shmFormat));
+    return format == QImage::Format_Invalid ? QImage::Format_ARGB32_Premultiplied : format;
+}
 
 QImage SharedMemoryBuffer::image() const
 {
@@ -148,14 +166,130 @@ QImage SharedMemoryBuffer::image() const
         int width = wl_shm_buffer_get_width(shmBuffer);
         int height = wl_shm_buffer_get_height(shmBuffer);
         int bytesPerLine = wl_shm_buffer_get_stride(shmBuffer);
+        QImage::Format format = imageFormatFromShmFormat(wl_shm_buffer_get_format(shmBuffer));
         uchar *data = static_cast<uchar *>(wl_shm_buffer_get_data(shmBuffer));
-        return QImage(data, width, height, bytesPerLine, QImage::Format_ARGB32_Premultiplied);
+        return QImage(data, width, height, bytesPerLine, format);
     }
 
     return QImage();
 }
 
+void SharedMemoryBuffer::setCommitted(QRegion &damage)
+{
+    // Damage piles up until the next upload. The surface passes everything
+    // that changed since this buffer was last committed, which includes the
+    // damage of the other buffers the client committed in between.
+    if (m_textureDirty)
+        m_textureDamage += damage;
+    else
+        m_textureDamage = damage;
+    ClientBuffer::setCommitted(damage);
+}
+
 #if QT_CONFIG(opengl)
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+#ifndef GL_BGRA_EXT
+#define GL_BGRA_EXT 0x80E1
+#endif
+#ifndef GL_UNSIGNED_SHORT_5_6_5
+#define GL_UNSIGNED_SHORT_5_6_5 0x8363
+#endif
+
+struct ShmUploadFormat
+{
+    QImage::Format imageFormat; // what the pixels have to be converted to, if anything
+    QOpenGLTexture::TextureFormat textureFormat;
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+};
+
+static bool hasUnpackRowLength()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    return !context->isOpenGLES() || context->format().majorVersion() >= 3
+            || context->hasExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
+}
+
+static bool hasBgraUpload()
+{
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+        return false;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    return !context->isOpenGLES() || context->hasExtension(QByteArrayLiteral("GL_EXT_texture_format_BGRA8888"));
+}
+
+// Picks a way to get the pixels into a texture that avoids converting them
+// on the CPU whenever the GL implementation can take them as they are.
+static ShmUploadFormat uploadFormatFor(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        // The X byte of XRGB8888 is undefined and ends up in the texture's
+        // alpha channel, where only a swizzle can hide it
+        if (hasBgraUpload() && (format == QImage::Format_ARGB32_Premultiplied
+                                || QOpenGLTexture::hasFeature(QOpenGLTexture::Swizzle))) {
+            const bool hasAlpha = format == QImage::Format_ARGB32_Premultiplied;
+            const GLenum internalFormat = QOpenGLContext::currentContext()->isOpenGLES() ? GL_BGRA_EXT : GL_RGBA;
+            return { format, hasAlpha ? QOpenGLTexture::RGBAFormat : QOpenGLTexture::RGBFormat,
+                     internalFormat, GL_BGRA_EXT, GL_UNSIGNED_BYTE };
+        }
+        break;
+    case QImage::Format_RGBX8888:
+        if (QOpenGLTexture::hasFeature(QOpenGLTexture::Swizzle))
+            return { format, QOpenGLTexture::RGBFormat, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE };
+        break;
+    case QImage::Format_RGBA8888_Premultiplied:
+        return { format, QOpenGLTexture::RGBAFormat, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE };
+    case QImage::Format_RGB16:
+        return { format, QOpenGLTexture::RGBFormat, GL_RGB, GL_RGB, GL_UNSIGNED_SHORT_5_6_5 };
+    default:
+        break;
+    }
+
+    if (QImage::toPixelFormat(format).alphaUsage() == QPixelFormat::UsesAlpha)
+        return { QImage::Format_RGBA8888_Premultiplied, QOpenGLTexture::RGBAFormat, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE };
+    // Undefined X bytes are dropped rather than trusted to be 0xff
+    if (format == QImage::Format_RGB32 || format == QImage::Format_RGBX8888)
+        return { QImage::Format_RGB888, QOpenGLTexture::RGBFormat, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE };
+    return { QImage::Format_RGBX8888, QOpenGLTexture::RGBFormat, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE };
+}
+
+static void uploadSubImage(const QImage &image, const QRect &rect, const ShmUploadFormat &uploadFormat)
+{
+    const int bytesPerPixel = image.depth() / 8;
+    QImage subImage(image.constScanLine(rect.y()) + rect.x() * bytesPerPixel,
+                    rect.width(), rect.height(), image.bytesPerLine(), image.format());
+
+    // Only the damaged rectangle gets converted, which leaves it tightly packed
+    if (subImage.format() != uploadFormat.imageFormat)
+        subImage = subImage.convertToFormat(uploadFormat.imageFormat);
+
+    const int rowLength = subImage.bytesPerLine() / (subImage.depth() / 8);
+    bool setRowLength = rowLength != rect.width();
+    if (setRowLength && !hasUnpackRowLength()) {
+        subImage = subImage.copy();
+        setRowLength = false;
+    }
+
+    const int bytesPerLine = subImage.bytesPerLine();
+    const int alignment = bytesPerLine % 4 == 0 ? 4 : (bytesPerLine % 2 == 0 ? 2 : 1);
+
+    if (setRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+    if (alignment != 4)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                    uploadFormat.format, uploadFormat.type, subImage.constBits());
+    if (alignment != 4)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (setRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
 QOpenGLTexture *SharedMemoryBuffer::toOpenGlTexture(int plane)
 {
     Q_UNUSED(plane);
@@ -168,20 +302,32 @@ QOpenGLTexture *SharedMemoryBuffer::toOpenGlTexture(int plane)
             m_textureDirty = false;
             m_shmTexture->bind();
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            // TODO: partial texture upload
-            QImage image = this->image();
-            m_shmTexture->setSize(image.width(), image.height());
-            if (image.hasAlphaChannel()) {
-                m_shmTexture->setFormat(QOpenGLTexture::RGBAFormat);
-                if (image.format() != QImage::Format_RGBA8888)
-                    image = image.convertToFormat(QImage::Format_RGBA8888);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
-            } else {
-                m_shmTexture->setFormat(QOpenGLTexture::RGBFormat);
-                if (image.format() != QImage::Format_RGBX8888)
-                    image = image.convertToFormat(QImage::Format_RGBX8888);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, image.constBits());
+            const QImage image = this->image();
+            const ShmUploadFormat uploadFormat = uploadFormatFor(image.format());
+            QRegion damage = m_textureDamage.intersected(image.rect());
+            m_textureDamage = QRegion();
+
+            if (m_shmTexture->width() != image.width() || m_shmTexture->height() != image.height()
+                    || m_shmTexture->format() != uploadFormat.textureFormat
+                    || m_shmInternalFormat != uploadFormat.internalFormat) {
+                m_shmTexture->setSize(image.width(), image.height());
+                m_shmTexture->setFormat(uploadFormat.textureFormat);
+                m_shmInternalFormat = uploadFormat.internalFormat;
+                glTexImage2D(GL_TEXTURE_2D, 0, uploadFormat.internalFormat, image.width(), image.height(), 0,
+                             uploadFormat.format, uploadFormat.type, nullptr);
+                // Formats without alpha may still upload a fourth byte,
+                // which must not make the texture translucent
+                if (QOpenGLTexture::hasFeature(QOpenGLTexture::Swizzle)) {
+                    const bool opaque = uploadFormat.textureFormat == QOpenGLTexture::RGBFormat;
+                    m_shmTexture->setSwizzleMask(QOpenGLTexture::SwizzleAlpha,
+                                                 opaque ? QOpenGLTexture::OneValue : QOpenGLTexture::AlphaValue);
+                }
+                damage = image.rect();
             }
+
+            for (const QRect &rect : damage)
+                uploadSubImage(image, rect, uploadFormat);
+
             //we can release the buffer after uploading, since we have a copy
             if (isCommitted())
                 sendRelease();
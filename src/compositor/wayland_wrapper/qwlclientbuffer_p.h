@@ -94,6 +94,10 @@ public:
 
     inline bool isCommitted() const { return m_committed; }
     virtual void setCommitted(QRegion &damage);
+
+    // Identifies the surface commit that last committed this buffer
+    quint64 commitSerial() const { return m_commitSerial; }
+    void setCommitSerial(quint64 serial) { m_commitSerial = serial; }
     bool isDestroyed() { return m_destroyed; }
 
     inline struct ::wl_resource *waylandBufferHandle() const { return m_buffer; }
@@ -119,6 +123,7 @@ protected:
 private:
     bool m_committed;
     bool m_destroyed;
+    quint64 m_commitSerial;
 
     QAtomicInt m_refCount;
 
@@ -134,13 +139,18 @@ public:
     QSize size() const override;
     QWaylandSurface::Origin origin() const  override;
     QImage image() const override;
+    void setCommitted(QRegion &damage) override;
 
 #if QT_CONFIG(opengl)
     QOpenGLTexture *toOpenGlTexture(int plane = 0) override;
+#endif
 
 private:
+#if QT_CONFIG(opengl)
     QOpenGLTexture *m_shmTexture;
+    GLenum m_shmInternalFormat;
 #endif
+    QRegion m_textureDamage;
 };
 
 }
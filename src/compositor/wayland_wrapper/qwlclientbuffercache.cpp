@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qwlclientbuffercache_p.h"
+#include "qwlclientbuffer_p.h"
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+ClientBufferCache::ClientBufferCache()
+    : m_cost(0)
+    , m_limit(0)
+{
+}
+
+// Adds a buffer whose images were just imported, as the most recently used one.
+void ClientBufferCache::insert(ClientBuffer *buffer, qint64 cost)
+{
+    if (remove(buffer))
+        qWarning("QtWayland::ClientBufferCache: buffer inserted twice");
+    m_buffers.append(buffer);
+    m_costs.insert(buffer, cost);
+    m_cost += cost;
+}
+
+// Returns whether the buffer was cached
+bool ClientBufferCache::remove(ClientBuffer *buffer)
+{
+    auto it = m_costs.find(buffer);
+    if (it == m_costs.end())
+        return false;
+    m_cost -= *it;
+    m_costs.erase(it);
+    m_buffers.removeOne(buffer);
+    return true;
+}
+
+void ClientBufferCache::use(ClientBuffer *buffer)
+{
+    if (!m_costs.contains(buffer))
+        return;
+    m_buffers.removeOne(buffer);
+    m_buffers.append(buffer);
+}
+
+// Removes the least recently used buffers until the cache fits its limit,
+// and returns them so that their images can be released. Buffers the client
+// has committed and the one in use are kept, so a steady swapchain stays cached.
+QVector<ClientBuffer *> ClientBufferCache::evict(const ClientBuffer *inUse)
+{
+    QVector<ClientBuffer *> evicted;
+    for (auto it = m_buffers.begin(); m_cost > m_limit && it != m_buffers.end();) {
+        ClientBuffer *buffer = *it;
+        if (buffer == inUse || buffer->isCommitted()) {
+            ++it;
+            continue;
+        }
+        m_cost -= m_costs.take(buffer);
+        it = m_buffers.erase(it);
+        evicted.append(buffer);
+    }
+    return evicted;
+}
+
+}
+
+QT_END_NAMESPACE
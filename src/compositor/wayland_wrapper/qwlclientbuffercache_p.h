@@ -0,0 +1,95 @@
+/****************************************************************************
+**
+** Copyright (C) 2017 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the QtWaylandCompositor module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QWLCLIENTBUFFERCACHE_P_H
+#define QWLCLIENTBUFFERCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <QtWaylandCompositor/private/qtwaylandcompositorglobal_p.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QtWayland {
+
+class ClientBuffer;
+
+// Keeps track of the client buffers that hold on to imported images, least
+// recently used first, and of what those images cost. Not thread-safe.
+class Q_WAYLAND_COMPOSITOR_EXPORT ClientBufferCache
+{
+public:
+    ClientBufferCache();
+
+    qint64 limit() const { return m_limit; }
+    void setLimit(qint64 limit) { m_limit = limit; }
+    qint64 cost() const { return m_cost; }
+    int count() const { return m_buffers.size(); }
+    bool contains(ClientBuffer *buffer) const { return m_costs.contains(buffer); }
+
+    void insert(ClientBuffer *buffer, qint64 cost);
+    bool remove(ClientBuffer *buffer);
+    void use(ClientBuffer *buffer);
+    QVector<ClientBuffer *> evict(const ClientBuffer *inUse);
+
+private:
+    QList<ClientBuffer *> m_buffers;
+    QHash<ClientBuffer *, qint64> m_costs;
+    qint64 m_cost;
+    qint64 m_limit;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QWLCLIENTBUFFERCACHE_P_H
@@ -50,6 +50,7 @@
 
 #include <QtCore/QDebug>
 #include <QtCore/QSocketNotifier>
+#include <algorithm>
 #include <fcntl.h>
 #include <QtCore/private/qcore_unix_p.h>
 #include <QtCore/QFile>
@@ -58,14 +59,60 @@ QT_BEGIN_NAMESPACE
 
 namespace QtWayland {
 
+// Retained selection limits, overridable with QT_WAYLAND_RETAINED_SELECTION_MAX_TYPE_SIZE
+// and QT_WAYLAND_RETAINED_SELECTION_MAX_SIZE (in bytes)
+static const int defaultMaxRetainedTypeSize = 16 * 1024 * 1024;
+static const int defaultMaxRetainedSize = 32 * 1024 * 1024;
+// Formats other than text are only captured if the selection is kept this long
+static const int secondaryRetainDelay = 500;
+static const int retainedReadChunkSize = 64 * 1024;
+// Upper bound of what is read per notifier activation, to keep the event loop responsive
+static const int maxRetainedReadPerActivation = 1024 * 1024;
+
+static int envLimit(const char *name, int defaultValue)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok && value >= 0 ? value : defaultValue;
+}
+
+// Formats that are most likely to be pasted come first
+static int mimeTypePriority(const QString &mimeType)
+{
+    if (mimeType == QLatin1String("text/plain;charset=utf-8"))
+        return 0;
+    if (mimeType.startsWith(QLatin1String("text/plain")))
+        return 1;
+    if (mimeType == QLatin1String("text/uri-list"))
+        return 2;
+    if (mimeType == QLatin1String("text/html"))
+        return 3;
+    if (mimeType.startsWith(QLatin1String("text/")))
+        return 4;
+    if (mimeType.startsWith(QLatin1String("image/")))
+        return 5;
+    return 6;
+}
+
+static const int lastPrimaryMimeTypePriority = 4;
+
 DataDeviceManager::DataDeviceManager(QWaylandCompositor *compositor)
     : QObject(0)
     , wl_data_device_manager(compositor->display(), 1)
     , m_compositor(compositor)
     , m_current_selection_source(0)
     , m_retainedReadNotifier(0)
+    , m_retainedPrimaryCount(0)
+    , m_retainedReadIndex(0)
+    , m_retainedSize(0)
+    , m_maxRetainedTypeSize(envLimit("QT_WAYLAND_RETAINED_SELECTION_MAX_TYPE_SIZE", defaultMaxRetainedTypeSize))
+    , m_maxRetainedSize(envLimit("QT_WAYLAND_RETAINED_SELECTION_MAX_SIZE", defaultMaxRetainedSize))
+    , m_retainSecondaryTypes(false)
     , m_compositorOwnsSelection(false)
 {
+    m_retainSecondaryTimer.setSingleShot(true);
+    m_retainSecondaryTimer.setInterval(secondaryRetainDelay);
+    connect(&m_retainSecondaryTimer, SIGNAL(timeout()), SLOT(retainSecondaryTypes()));
 }
 
 void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
@@ -79,6 +126,7 @@ void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
     m_compositorOwnsSelection = false;
 
     finishReadFromClient();
+    m_retainSecondaryTimer.stop();
 
     m_current_selection_source = source;
     if (source)
@@ -90,28 +138,55 @@ void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
     //    2. make it possible for the compositor to participate in copy-paste
     // The downside is decreased performance, therefore this mode has to be enabled
     // explicitly in the compositors.
+    // Text formats are read right away, the others only once the selection has
+    // been kept for a while, and everything is subject to the size limits.
     if (source && m_compositor->retainedSelectionEnabled()) {
         m_retainedData.clear();
+        m_retainedMimeTypes = source->mimeTypes();
+        std::stable_sort(m_retainedMimeTypes.begin(), m_retainedMimeTypes.end(),
+                         [](const QString &a, const QString &b) { return mimeTypePriority(a) < mimeTypePriority(b); });
+        m_retainedPrimaryCount = 0;
+        while (m_retainedPrimaryCount < m_retainedMimeTypes.size()
+               && mimeTypePriority(m_retainedMimeTypes.at(m_retainedPrimaryCount)) <= lastPrimaryMimeTypePriority)
+            ++m_retainedPrimaryCount;
+        if (m_retainedPrimaryCount == 0 && !m_retainedMimeTypes.isEmpty())
+            m_retainedPrimaryCount = 1;
         m_retainedReadIndex = 0;
+        m_retainedSize = 0;
+        m_retainSecondaryTypes = false;
         retain();
     }
 }
 
 void DataDeviceManager::sourceDestroyed(DataSource *source)
 {
-    if (m_current_selection_source == source)
+    if (m_current_selection_source == source) {
+        // retain() already handed out the data once everything was read
+        const bool alreadyFed = m_retainedReadIndex >= m_retainedMimeTypes.count()
+                || m_retainedSize >= m_maxRetainedSize;
         finishReadFromClient();
+        m_retainSecondaryTimer.stop();
+        // Hand out what was captured so far, whether the other formats were
+        // still to be read or in the middle of being read
+        if (m_compositor->retainedSelectionEnabled() && !alreadyFed
+                && m_retainedReadIndex >= m_retainedPrimaryCount)
+            QWaylandCompositorPrivate::get(m_compositor)->feedRetainedSelectionData(&m_retainedData);
+    }
 }
 
 void DataDeviceManager::retain()
 {
-    QList<QString> offers = m_current_selection_source->mimeTypes();
     finishReadFromClient();
-    if (m_retainedReadIndex >= offers.count()) {
+    if (m_retainedReadIndex == m_retainedPrimaryCount && !m_retainSecondaryTypes
+            && m_retainedReadIndex < m_retainedMimeTypes.count() && m_retainedSize < m_maxRetainedSize) {
+        m_retainSecondaryTimer.start();
+        return;
+    }
+    if (m_retainedReadIndex >= m_retainedMimeTypes.count() || m_retainedSize >= m_maxRetainedSize) {
         QWaylandCompositorPrivate::get(m_compositor)->feedRetainedSelectionData(&m_retainedData);
         return;
     }
-    QString mimeType = offers.at(m_retainedReadIndex);
+    QString mimeType = m_retainedMimeTypes.at(m_retainedReadIndex);
     m_retainedReadBuf.clear();
     int fd[2];
     if (pipe(fd) == -1) {
@@ -124,6 +199,14 @@ void DataDeviceManager::retain()
     connect(m_retainedReadNotifier, SIGNAL(activated(int)), SLOT(readFromClient(int)));
 }
 
+void DataDeviceManager::retainSecondaryTypes()
+{
+    if (!m_current_selection_source)
+        return;
+    m_retainSecondaryTypes = true;
+    retain();
+}
+
 void DataDeviceManager::finishReadFromClient(bool exhausted)
 {
     Q_UNUSED(exhausted);
@@ -141,9 +224,19 @@ void DataDeviceManager::finishReadFromClient(bool exhausted)
     }
 }
 
+// Gives up on the format being read because it exceeds the limits
+void DataDeviceManager::skipRetainedType()
+{
+    qWarning("Clipboard: Not retaining %s, it exceeds the size limit",
+             qPrintable(m_retainedMimeTypes.at(m_retainedReadIndex)));
+    m_retainedReadBuf.clear();
+    ++m_retainedReadIndex;
+    retain();
+}
+
 void DataDeviceManager::readFromClient(int fd)
 {
-    static char buf[4096];
+    static char buf[retainedReadChunkSize];
     int obsCount = m_obsoleteRetainedReadNotifiers.count();
     for (int i = 0; i < obsCount; ++i) {
         QSocketNotifier *sn = m_obsoleteRetainedReadNotifiers.at(i);
@@ -163,18 +256,31 @@ void DataDeviceManager::readFromClient(int fd)
             return;
         }
     }
-    int n = QT_READ(fd, buf, sizeof buf);
-    if (n <= 0) {
-        if (n != -1 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
-            finishReadFromClient(true);
-            QList<QString> offers = m_current_selection_source->mimeTypes();
-            QString mimeType = offers.at(m_retainedReadIndex);
-            m_retainedData.setData(mimeType, m_retainedReadBuf);
-            ++m_retainedReadIndex;
-            retain();
+
+    const int typeLimit = qMin(m_maxRetainedTypeSize, m_maxRetainedSize - m_retainedSize);
+    int readThisTime = 0;
+    int n;
+    do {
+        // Read straight into the buffer, without going beyond what we may keep
+        const int oldSize = m_retainedReadBuf.size();
+        const int chunk = qMin(retainedReadChunkSize, typeLimit - oldSize + 1);
+        m_retainedReadBuf.resize(oldSize + chunk);
+        n = QT_READ(fd, m_retainedReadBuf.data() + oldSize, chunk);
+        m_retainedReadBuf.resize(oldSize + qMax(n, 0));
+        if (m_retainedReadBuf.size() > typeLimit) {
+            skipRetainedType();
+            return;
         }
-    } else {
-        m_retainedReadBuf.append(buf, n);
+        readThisTime += qMax(n, 0);
+    } while (n > 0 && readThisTime < maxRetainedReadPerActivation);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        finishReadFromClient(true);
+        m_retainedData.setData(m_retainedMimeTypes.at(m_retainedReadIndex), m_retainedReadBuf);
+        m_retainedSize += m_retainedReadBuf.size();
+        m_retainedReadBuf.clear();
+        ++m_retainedReadIndex;
+        retain();
     }
 }
 
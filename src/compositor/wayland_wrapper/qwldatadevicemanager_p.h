@@ -55,6 +55,7 @@
 #include <QtCore/QMap>
 #include <QtGui/QClipboard>
 #include <QtCore/QMimeData>
+#include <QtCore/QTimer>
 
 #include <QtWaylandCompositor/QWaylandCompositor>
 
@@ -96,10 +97,12 @@ protected:
 
 private Q_SLOTS:
     void readFromClient(int fd);
+    void retainSecondaryTypes();
 
 private:
     void retain();
     void finishReadFromClient(bool exhausted = false);
+    void skipRetainedType();
 
     QWaylandCompositor *m_compositor;
     QList<DataDevice *> m_data_device_list;
@@ -109,8 +112,15 @@ private:
     QMimeData m_retainedData;
     QSocketNotifier *m_retainedReadNotifier;
     QList<QSocketNotifier *> m_obsoleteRetainedReadNotifiers;
+    QStringList m_retainedMimeTypes;
+    int m_retainedPrimaryCount;
     int m_retainedReadIndex;
     QByteArray m_retainedReadBuf;
+    int m_retainedSize;
+    int m_maxRetainedTypeSize;
+    int m_maxRetainedSize;
+    bool m_retainSecondaryTypes;
+    QTimer m_retainSecondaryTimer;
 
     bool m_compositorOwnsSelection;
 
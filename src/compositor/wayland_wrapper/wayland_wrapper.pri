@@ -5,12 +5,14 @@ WAYLANDSERVERSOURCES_SYSTEM += \
 HEADERS += \
     wayland_wrapper/qwlbuffermanager_p.h \
     wayland_wrapper/qwlclientbuffer_p.h \
+    wayland_wrapper/qwlclientbuffercache_p.h \
     wayland_wrapper/qwlregion_p.h \
     ../shared/qwaylandxkb_p.h \
 
 SOURCES += \
     wayland_wrapper/qwlbuffermanager.cpp \
     wayland_wrapper/qwlclientbuffer.cpp \
+    wayland_wrapper/qwlclientbuffercache.cpp \
     wayland_wrapper/qwlregion.cpp \
     ../shared/qwaylandxkb.cpp \
 
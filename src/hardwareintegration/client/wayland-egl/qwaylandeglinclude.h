@@ -48,4 +48,8 @@
 #define EGL_EGLEXT_PROTOTYPES
 #include <QtEglSupport/private/qt_egl_p.h>
 
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
 #endif // QWAYLANDEGLINCLUDE_H
@@ -40,6 +40,7 @@
 #include "qwaylandeglwindow.h"
 
 #include <QtWaylandClient/private/qwaylandscreen_p.h>
+#include <QtWaylandClient/private/qwaylandabstractdecoration_p.h>
 #include "qwaylandglcontext.h"
 
 #include <QtEglSupport/private/qeglconvenience_p.h>
@@ -104,7 +105,7 @@ void QWaylandEglWindow::setGeometry(const QRect &rect)
 
 void QWaylandEglWindow::updateSurface(bool create)
 {
-    QMargins margins = frameMargins();
+    QMargins margins = bufferMargins();
     QRect rect = geometry();
     QSize sizeWithMargins = (rect.size() + QSize(margins.left() + margins.right(), margins.top() + margins.bottom())) * scale();
 
@@ -146,7 +147,7 @@ void QWaylandEglWindow::updateSurface(bool create)
 QRect QWaylandEglWindow::contentsRect() const
 {
     QRect r = geometry();
-    QMargins m = frameMargins();
+    QMargins m = bufferMargins();
     return QRect(m.left(), m.bottom(), r.width(), r.height());
 }
 
@@ -185,9 +186,22 @@ EGLSurface QWaylandEglWindow::eglSurface() const
     return m_eglSurface;
 }
 
+int QWaylandEglWindow::bufferAge() const
+{
+    static const bool supported = q_hasEglExtension(m_clientBufferIntegration->eglDisplay(), "EGL_EXT_buffer_age");
+
+    // Rendering into the content FBO leaves nothing to reuse in the back buffer
+    if (!supported || !m_eglSurface || (decoration() && !decoration()->usesSubSurfaces()))
+        return 0;
+    EGLint age = 0;
+    if (!eglQuerySurface(m_clientBufferIntegration->eglDisplay(), m_eglSurface, EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+    return age;
+}
+
 GLuint QWaylandEglWindow::contentFBO() const
 {
-    if (!decoration())
+    if (!decoration() || decoration()->usesSubSurfaces())
         return 0;
 
     if (m_resize || !m_contentFBO) {
@@ -209,7 +223,7 @@ GLuint QWaylandEglWindow::contentTexture() const
 
 void QWaylandEglWindow::bindContentFBO()
 {
-    if (decoration()) {
+    if (decoration() && !decoration()->usesSubSurfaces()) {
         contentFBO();
         m_contentFBO->bind();
     }
@@ -76,6 +76,8 @@ public:
     void invalidateSurface() override;
     void setVisible(bool visible) override;
 
+    int bufferAge() const override;
+
 private Q_SLOTS:
     void doInvalidateSurface();
 
@@ -232,6 +232,7 @@ QWaylandGLContext::QWaylandGLContext(EGLDisplay eglDisplay, QWaylandDisplay *dis
     , m_blitter(0)
     , mUseNativeDefaultFbo(false)
     , mSupportNonBlockingSwap(true)
+    , m_eglSwapBuffersWithDamage(0)
 {
     QSurfaceFormat fmt = format;
     if (static_cast<QWaylandIntegration *>(QGuiApplicationPrivate::platformIntegration())->display()->supportsWindowDecoration())
@@ -313,6 +314,12 @@ QWaylandGLContext::QWaylandGLContext(EGLDisplay eglDisplay, QWaylandDisplay *dis
         qWarning() << "Non-blocking swap buffers not supported. Subsurface rendering can be affected.";
     }
 
+    // Lets the compositor only update what changed, instead of the whole window
+    if (q_hasEglExtension(m_eglDisplay, "EGL_KHR_swap_buffers_with_damage"))
+        m_eglSwapBuffersWithDamage = reinterpret_cast<SwapBuffersWithDamage>(eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    else if (q_hasEglExtension(m_eglDisplay, "EGL_EXT_swap_buffers_with_damage"))
+        m_eglSwapBuffersWithDamage = reinterpret_cast<SwapBuffersWithDamage>(eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+
     updateGLFormat();
 }
 
@@ -529,7 +536,14 @@ void QWaylandGLContext::swapBuffers(QPlatformSurface *surface)
 
     EGLSurface eglSurface = window->eglSurface();
 
-    if (window->decoration()) {
+    // The decorations blitter redraws the whole surface
+    const bool fullDamage = window->decoration() && !window->decoration()->usesSubSurfaces();
+
+    if (window->decoration() && window->decoration()->usesSubSurfaces()) {
+        // Nothing to blit, the decoration is committed on its own and
+        // applied together with the content
+        window->decoration()->commitSubSurfaces();
+    } else if (window->decoration()) {
         makeCurrent(surface);
 
         // Must save & restore all state. Applications are usually not prepared
@@ -549,16 +563,34 @@ void QWaylandGLContext::swapBuffers(QPlatformSurface *surface)
         int si = (sub->isSync() && mSupportNonBlockingSwap) ? 0 : m_format.swapInterval();
 
         eglSwapInterval(m_eglDisplay, si);
-        eglSwapBuffers(m_eglDisplay, eglSurface);
+        swapBuffersWithDamage(window, eglSurface, fullDamage);
     } else {
         eglSwapInterval(m_eglDisplay, m_format.swapInterval());
-        eglSwapBuffers(m_eglDisplay, eglSurface);
+        swapBuffersWithDamage(window, eglSurface, fullDamage);
     }
 
 
     window->setCanResize(true);
 }
 
+// Passes the damage set on the window to the compositor, or the whole window
+// when there is none or the EGL implementation can't take it.
+void QWaylandGLContext::swapBuffersWithDamage(QWaylandEglWindow *window, EGLSurface eglSurface, bool fullDamage)
+{
+    // The rectangles are flipped against the surface's own height, which
+    // lags behind the window geometry while a resize is pending
+    EGLint height = 0;
+    const bool useDamage = m_eglSwapBuffersWithDamage && !fullDamage
+            && eglQuerySurface(m_eglDisplay, eglSurface, EGL_HEIGHT, &height);
+    const QVector<EGLint> rects = window->takeSwapDamageRects(height);
+    if (!useDamage || rects.isEmpty()) {
+        eglSwapBuffers(m_eglDisplay, eglSurface);
+        return;
+    }
+
+    m_eglSwapBuffersWithDamage(m_eglDisplay, eglSurface, rects.constData(), rects.size() / 4);
+}
+
 GLuint QWaylandGLContext::defaultFramebufferObject(QPlatformSurface *surface) const
 {
     if (mUseNativeDefaultFbo)
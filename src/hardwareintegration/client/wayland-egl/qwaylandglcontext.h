@@ -54,6 +54,7 @@ class QOpenGLTextureCache;
 namespace QtWaylandClient {
 
 class QWaylandWindow;
+class QWaylandEglWindow;
 class QWaylandGLWindowSurface;
 class DecorationsBlitter;
 
@@ -82,6 +83,7 @@ public:
 
 private:
     void updateGLFormat();
+    void swapBuffersWithDamage(QWaylandEglWindow *window, EGLSurface eglSurface, bool fullDamage);
 
     EGLDisplay m_eglDisplay;
     QWaylandDisplay *m_display;
@@ -94,6 +96,9 @@ private:
     uint m_api;
     bool mSupportNonBlockingSwap;
 
+    typedef EGLBoolean (EGLAPIENTRYP SwapBuffersWithDamage)(EGLDisplay dpy, EGLSurface surface, const EGLint *rects, EGLint n_rects);
+    SwapBuffersWithDamage m_eglSwapBuffersWithDamage;
+
     friend class DecorationsBlitter;
 };
 
@@ -86,10 +86,10 @@ DrmEglServerBuffer::DrmEglServerBuffer(DrmEglServerBufferIntegration *integratio
 
 struct ::wl_resource *DrmEglServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    QMultiMap<struct ::wl_client *, Resource *>::iterator it = resourceMap().find(client);
-    if (it == resourceMap().end()) {
-        QMultiMap<struct ::wl_client *, QtWaylandServer::qt_drm_egl_server_buffer::Resource *>::iterator drm_egl_it = m_integration->resourceMap().find(client);
-        if (drm_egl_it == m_integration->resourceMap().end()) {
+    QMultiMap<struct ::wl_client *, Resource *>::const_iterator it = resourceMap().constFind(client);
+    if (it == resourceMap().constEnd()) {
+        QMultiMap<struct ::wl_client *, QtWaylandServer::qt_drm_egl_server_buffer::Resource *>::const_iterator drm_egl_it = m_integration->resourceMap().constFind(client);
+        if (drm_egl_it == m_integration->resourceMap().constEnd()) {
             qWarning("DrmEglServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the drm_egl interface");
             return 0;
         }
@@ -80,10 +80,10 @@ LibHybrisEglServerBuffer::LibHybrisEglServerBuffer(LibHybrisEglServerBufferInteg
 
 struct ::wl_resource *LibHybrisEglServerBuffer::resourceForClient(struct ::wl_client *client)
 {
-    QMultiMap<struct ::wl_client *, Resource *>::iterator it = resourceMap().find(client);
-    if (it == resourceMap().end()) {
-        QMultiMap<struct ::wl_client *, QtWaylandServer::qt_libhybris_egl_server_buffer::Resource *>::iterator egl_it = m_integration->resourceMap().find(client);
-        if (egl_it == m_integration->resourceMap().end()) {
+    QMultiMap<struct ::wl_client *, Resource *>::const_iterator it = resourceMap().constFind(client);
+    if (it == resourceMap().constEnd()) {
+        QMultiMap<struct ::wl_client *, QtWaylandServer::qt_libhybris_egl_server_buffer::Resource *>::const_iterator egl_it = m_integration->resourceMap().constFind(client);
+        if (egl_it == m_integration->resourceMap().constEnd()) {
             qWarning("LibHybrisEglServerBuffer::resourceForClient: Trying to get resource for ServerBuffer. But client is not bound to the libhybris_egl interface");
             return 0;
         }
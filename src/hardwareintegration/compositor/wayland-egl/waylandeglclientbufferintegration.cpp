@@ -40,6 +40,7 @@
 #include "waylandeglclientbufferintegration.h"
 
 #include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/private/qwlclientbuffercache_p.h>
 #include <qpa/qplatformnativeinterface.h>
 #include <QtGui/QGuiApplication>
 #include <QtGui/QOpenGLContext>
@@ -161,6 +162,7 @@ struct BufferState
     EGLint egl_format;
     QVarLengthArray<EGLImageKHR, 3> egl_images;
     QOpenGLTexture *textures[3];
+    bool texturesDirty[3];
     EGLStreamKHR egl_stream;
 
     bool isYInverted;
@@ -178,6 +180,12 @@ public:
     void init_egl_fd_texture(WaylandEglClientBuffer *buffer, wl_resource *bufferHandle);
     void register_buffer(struct ::wl_resource *buffer, BufferState state);
 
+    void createImages(WaylandEglClientBuffer *buffer);
+    void releaseImages(BufferState &state, QVector<QOpenGLTexture *> *textures);
+    void addToCache(WaylandEglClientBuffer *buffer);
+    void removeFromCache(WaylandEglClientBuffer *buffer);
+    void useCachedBuffer(WaylandEglClientBuffer *buffer);
+
     EGLDisplay egl_display;
     bool valid;
     bool display_bound;
@@ -192,6 +200,15 @@ public:
     PFNGLEGLIMAGETARGETTEXTURE2DOESPROC gl_egl_image_target_texture_2d;
 
     QEGLStreamConvenience *funcs;
+
+    // Buffers whose EGLImages are alive, least recently used first. Buffers
+    // are added on the GUI thread when they are first attached, and used and
+    // evicted on the render thread, which is the only place where textures
+    // can be deleted.
+    QMutex cacheMutex;
+    QtWayland::ClientBufferCache cache;
+    QVector<QOpenGLTexture *> orphanedTextures;
+
     static WaylandEglClientBufferIntegrationPrivate *get(WaylandEglClientBufferIntegration *integration) {
         return integration->d_ptr.data();
     }
@@ -199,6 +216,8 @@ public:
 
 BufferState::BufferState()
     : egl_format(EGL_TEXTURE_RGBA)
+    , textures()
+    , texturesDirty()
     , egl_stream(EGL_NO_STREAM_KHR)
     , isYInverted(true)
     , eglMode(ModeNone)
@@ -216,6 +235,8 @@ WaylandEglClientBufferIntegrationPrivate::WaylandEglClientBufferIntegrationPriva
     , gl_egl_image_target_texture_2d(0)
     , funcs(Q_NULLPTR)
 {
+    const int limit = qEnvironmentVariableIntValue("QT_WAYLAND_EGL_IMAGE_CACHE_LIMIT");
+    cache.setLimit(qint64(limit > 0 ? limit : 256) * 1024 * 1024);
 }
 
 void WaylandEglClientBufferIntegrationPrivate::initBuffer(WaylandEglClientBuffer *buffer)
@@ -252,25 +273,46 @@ void WaylandEglClientBufferIntegrationPrivate::init_egl_texture(WaylandEglClient
     state.isYInverted = (ret == EGL_FALSE || isYInverted == EGL_TRUE);
 #endif
 
-    int planes = 1;
+    createImages(buffer);
+    addToCache(buffer);
+}
 
+static int planeCount(EGLint format)
+{
     switch (format) {
     default:
     case EGL_TEXTURE_RGB:
     case EGL_TEXTURE_RGBA:
     case EGL_TEXTURE_EXTERNAL_WL:
-        planes = 1;
-        break;
+        return 1;
     case EGL_TEXTURE_Y_UV_WL:
-        planes = 2;
-        break;
+        return 2;
     case EGL_TEXTURE_Y_U_V_WL:
-        planes = 3;
-        break;
+        return 3;
     case EGL_TEXTURE_Y_XUXV_WL:
-        planes = 2;
-        break;
+        return 2;
     }
+}
+
+// Estimated size of the images the driver keeps for the buffer
+static qint64 imageCost(const BufferState &state)
+{
+    const qint64 pixels = qint64(state.size.width()) * state.size.height();
+    switch (state.egl_format) {
+    case EGL_TEXTURE_Y_UV_WL:
+    case EGL_TEXTURE_Y_U_V_WL:
+        return pixels * 3 / 2;
+    case EGL_TEXTURE_Y_XUXV_WL:
+        return pixels * 2;
+    default:
+        return pixels * 4;
+    }
+}
+
+void WaylandEglClientBufferIntegrationPrivate::createImages(WaylandEglClientBuffer *buffer)
+{
+    BufferState &state = *buffer->d;
+    const int planes = planeCount(state.egl_format);
 
     for (int i = 0; i < planes; i++) {
         const EGLint attribs[] = { EGL_WAYLAND_PLANE_WL, i, EGL_NONE };
@@ -288,6 +330,68 @@ void WaylandEglClientBufferIntegrationPrivate::init_egl_texture(WaylandEglClient
     }
 }
 
+// Destroys the EGLImages of the buffer and hands its textures to the caller,
+// who must delete them with the render context current.
+void WaylandEglClientBufferIntegrationPrivate::releaseImages(BufferState &state, QVector<QOpenGLTexture *> *textures)
+{
+    for (EGLImageKHR image : qAsConst(state.egl_images)) {
+        if (image != EGL_NO_IMAGE_KHR)
+            egl_destroy_image(egl_display, image);
+    }
+    state.egl_images.clear();
+
+    for (QOpenGLTexture *&texture : state.textures) {
+        if (texture)
+            textures->append(texture);
+        texture = nullptr;
+    }
+}
+
+void WaylandEglClientBufferIntegrationPrivate::addToCache(WaylandEglClientBuffer *buffer)
+{
+    QMutexLocker locker(&cacheMutex);
+    cache.insert(buffer, imageCost(*buffer->d));
+}
+
+void WaylandEglClientBufferIntegrationPrivate::removeFromCache(WaylandEglClientBuffer *buffer)
+{
+    QMutexLocker locker(&cacheMutex);
+    cache.remove(buffer);
+    releaseImages(*buffer->d, &orphanedTextures);
+}
+
+// Called on the render thread before the textures of a buffer are used. Deletes
+// the textures of destroyed buffers, imports the buffer again if it was evicted,
+// and evicts the least recently used buffers the client isn't currently using
+// until the cache fits its limit. Buffers of a steady swapchain stay cached.
+void WaylandEglClientBufferIntegrationPrivate::useCachedBuffer(WaylandEglClientBuffer *buffer)
+{
+    BufferState &state = *buffer->d;
+    QVector<QOpenGLTexture *> textures;
+    bool cached;
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        textures.swap(orphanedTextures);
+        cached = cache.contains(buffer);
+        cache.use(buffer);
+    }
+
+    if (state.eglMode == BufferState::ModeEGLImage && !cached) {
+        createImages(buffer);
+        addToCache(buffer);
+    }
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        const QVector<QtWayland::ClientBuffer *> evicted = cache.evict(buffer);
+        for (QtWayland::ClientBuffer *evictedBuffer : evicted)
+            releaseImages(*static_cast<WaylandEglClientBuffer *>(evictedBuffer)->d, &textures);
+    }
+
+    qDeleteAll(textures);
+}
+
 void WaylandEglClientBufferIntegrationPrivate::init_egl_fd_texture(WaylandEglClientBuffer *buffer, struct ::wl_resource *bufferHandle)
 {
 //EglStreams case
@@ -437,6 +541,17 @@ WaylandEglClientBuffer::WaylandEglClientBuffer(WaylandEglClientBufferIntegration
     }
 }
 
+WaylandEglClientBuffer::~WaylandEglClientBuffer()
+{
+    auto *p = WaylandEglClientBufferIntegrationPrivate::get(m_integration);
+
+    p->removeFromCache(this);
+    if (d->egl_stream != EGL_NO_STREAM_KHR)
+        p->funcs->destroy_stream(p->egl_display, d->egl_stream);
+
+    delete d;
+}
+
 static QWaylandBufferRef::BufferFormatEgl formatFromEglFormat(EGLint format) {
     switch (format) {
     case EGL_TEXTURE_RGB:
@@ -478,6 +593,9 @@ QOpenGLTexture *WaylandEglClientBuffer::toOpenGlTexture(int plane)
         return nullptr;
 
     auto *p = WaylandEglClientBufferIntegrationPrivate::get(m_integration);
+    if (plane == 0)
+        p->useCachedBuffer(this);
+
     auto texture = d->textures[plane];
     const auto target = static_cast<QOpenGLTexture::Target>((d->eglMode == BufferState::ModeEGLStream || d->egl_format == EGL_TEXTURE_EXTERNAL_WL) ? GL_TEXTURE_EXTERNAL_OES
                                                                         : GL_TEXTURE_2D);
@@ -487,6 +605,7 @@ QOpenGLTexture *WaylandEglClientBuffer::toOpenGlTexture(int plane)
         texture->setSize(d->size.width(), d->size.height());
         texture->create();
         d->textures[plane] = texture;
+        d->texturesDirty[plane] = true;
     }
 
 
@@ -504,7 +623,19 @@ QOpenGLTexture *WaylandEglClientBuffer::toOpenGlTexture(int plane)
                     qWarning("%s:%d: eglStreamConsumerAcquireKHR failed: 0x%x", Q_FUNC_INFO, __LINE__, eglGetError());
             }
         }
-    } else if (m_textureDirty) {
+    } else {
+        // The EGLImages of all planes were created when the buffer was first
+        // attached. Bind each of them to its texture once per commit, not
+        // every time the plane is asked for.
+        if (m_textureDirty) {
+            m_textureDirty = false;
+            for (bool &dirty : d->texturesDirty)
+                dirty = true;
+        }
+        if (!d->texturesDirty[plane] || plane >= d->egl_images.size())
+            return texture;
+        d->texturesDirty[plane] = false;
+
         texture->bind();
         glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         p->gl_egl_image_target_texture_2d(target, d->egl_images[plane]);
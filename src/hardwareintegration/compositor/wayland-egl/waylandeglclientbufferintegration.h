@@ -68,6 +68,8 @@ struct BufferState;
 class WaylandEglClientBuffer : public QtWayland::ClientBuffer
 {
 public:
+    ~WaylandEglClientBuffer() override;
+
     QWaylandBufferRef::BufferFormatEgl bufferFormatEgl() const override;
     QSize size() const override;
     QWaylandSurface::Origin origin() const override;
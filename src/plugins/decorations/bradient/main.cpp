@@ -145,10 +145,12 @@ private:
     void processMouseLeft(QWaylandInputDevice *inputDevice, const QPointF &local, Qt::MouseButtons b,Qt::KeyboardModifiers mods);
     void processMouseRight(QWaylandInputDevice *inputDevice, const QPointF &local, Qt::MouseButtons b,Qt::KeyboardModifiers mods);
     bool clickButton(Qt::MouseButtons b, Button btn);
+    void setClicking(Button btn);
 
     QRectF closeButtonRect() const;
     QRectF maximizeButtonRect() const;
     QRectF minimizeButtonRect() const;
+    QRectF buttonRect(Button btn) const;
 
     QColor m_foregroundColor;
     QColor m_backgroundColor;
@@ -189,6 +191,21 @@ QRectF QWaylandBradientDecoration::minimizeButtonRect() const
                   (margins().top() - BUTTON_WIDTH) / 2, BUTTON_WIDTH, BUTTON_WIDTH);
 }
 
+QRectF QWaylandBradientDecoration::buttonRect(Button btn) const
+{
+    switch (btn) {
+    case Close:
+        return closeButtonRect();
+    case Maximize:
+        return maximizeButtonRect();
+    case Minimize:
+        return minimizeButtonRect();
+    case None:
+        break;
+    }
+    return QRectF();
+}
+
 QMargins QWaylandBradientDecoration::margins() const
 {
     return QMargins(3, 30, 3, 3);
@@ -264,6 +281,13 @@ void QWaylandBradientDecoration::paint(QPaintDevice *device)
         p.restore();
     }
 
+    // Pressed button
+    if (m_clicking != None) {
+        QColor pressed(m_foregroundColor);
+        pressed.setAlpha(64);
+        p.fillRect(buttonRect(m_clicking), pressed);
+    }
+
 #if QT_CONFIG(imageformat_xpm)
     p.save();
 
@@ -334,24 +358,38 @@ void QWaylandBradientDecoration::paint(QPaintDevice *device)
 bool QWaylandBradientDecoration::clickButton(Qt::MouseButtons b, Button btn)
 {
     if (isLeftClicked(b)) {
-        m_clicking = btn;
+        setClicking(btn);
         return false;
     } else if (isLeftReleased(b)) {
         if (m_clicking == btn) {
-            m_clicking = None;
+            setClicking(None);
             return true;
         } else {
-            m_clicking = None;
+            setClicking(None);
         }
     }
     return false;
 }
 
+// Only the title bar, which holds the buttons, is painted again
+void QWaylandBradientDecoration::setClicking(Button btn)
+{
+    if (btn == m_clicking)
+        return;
+    m_clicking = btn;
+    update(edgeRect(TopEdge));
+    window()->requestUpdate();
+}
+
 bool QWaylandBradientDecoration::handleMouse(QWaylandInputDevice *inputDevice, const QPointF &local, const QPointF &global, Qt::MouseButtons b, Qt::KeyboardModifiers mods)
 
 {
     Q_UNUSED(global);
 
+    // A press released away from its button does not click it
+    if (isLeftReleased(b) && !buttonRect(m_clicking).contains(local))
+        setClicking(None);
+
     // Figure out what area mouse is in
     if (closeButtonRect().contains(local)) {
         if (clickButton(b, Close))
@@ -147,8 +147,8 @@ QWaylandShellSurface *QWaylandIviShellIntegration::createShellSurface(QWaylandWi
         QWaylandWindow *parent = window->transientParent();
         if (parent && parent->decoration()) {
             transientPos -= parent->geometry().topLeft();
-            transientPos.setX(transientPos.x() + parent->decoration()->margins().left());
-            transientPos.setY(transientPos.y() + parent->decoration()->margins().top());
+            transientPos.setX(transientPos.x() + parent->bufferMargins().left());
+            transientPos.setY(transientPos.y() + parent->bufferMargins().top());
         }
         QSize size = window->window()->geometry().size();
         iviSurface->ivi_controller_surface::set_destination_rectangle(transientPos.x(),
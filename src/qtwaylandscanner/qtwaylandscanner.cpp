@@ -379,8 +379,10 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
         else
             printf("#include <%s/wayland-%s-server-protocol.h>\n", headerPath.constData(), QByteArray(protocolName).replace('_', '-').constData());
         printf("#include <QByteArray>\n");
+        printf("#include <QHash>\n");
         printf("#include <QMultiMap>\n");
         printf("#include <QString>\n");
+        printf("#include <QVector>\n");
 
         printf("\n");
         printf("#ifndef WAYLAND_VERSION_CHECK\n");
@@ -455,8 +457,9 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
             printf("        Resource *resource() { return m_resource; }\n");
             printf("        const Resource *resource() const { return m_resource; }\n");
             printf("\n");
-            printf("        QMultiMap<struct ::wl_client*, Resource*> resourceMap() { return m_resource_map; }\n");
-            printf("        const QMultiMap<struct ::wl_client*, Resource*> resourceMap() const { return m_resource_map; }\n");
+            printf("        QMultiMap<struct ::wl_client*, Resource*> &resourceMap() { return m_resource_map; }\n");
+            printf("        const QMultiMap<struct ::wl_client*, Resource*> &resourceMap() const { return m_resource_map; }\n");
+            printf("        const QVector<Resource*> &resourcesForClient(struct ::wl_client *client) const;\n");
             printf("\n");
             printf("        bool isGlobal() const { return m_global != 0; }\n");
             printf("        bool isResource() const { return m_resource != 0; }\n");
@@ -524,6 +527,7 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
 
             printf("\n");
             printf("        QMultiMap<struct ::wl_client*, Resource*> m_resource_map;\n");
+            printf("        QHash<struct ::wl_client*, QVector<Resource*> > m_client_resources;\n");
             printf("        Resource *m_resource;\n");
             printf("        struct ::wl_global *m_global;\n");
             printf("        uint32_t m_globalVersion;\n");
@@ -626,6 +630,7 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
             printf("    {\n");
             printf("        Resource *resource = bind(client, 0, version);\n");
             printf("        m_resource_map.insert(client, resource);\n");
+            printf("        m_client_resources[client].append(resource);\n");
             printf("        return resource;\n");
             printf("    }\n");
             printf("\n");
@@ -634,10 +639,19 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
             printf("    {\n");
             printf("        Resource *resource = bind(client, id, version);\n");
             printf("        m_resource_map.insert(client, resource);\n");
+            printf("        m_client_resources[client].append(resource);\n");
             printf("        return resource;\n");
             printf("    }\n");
             printf("\n");
 
+            printf("    const QVector<%s::Resource*> &%s::resourcesForClient(struct ::wl_client *client) const\n", interfaceName, interfaceName);
+            printf("    {\n");
+            printf("        static const QVector<Resource*> noResources;\n");
+            printf("        QHash<struct ::wl_client*, QVector<Resource*> >::const_iterator it = m_client_resources.constFind(client);\n");
+            printf("        return it != m_client_resources.constEnd() ? *it : noResources;\n");
+            printf("    }\n");
+            printf("\n");
+
             printf("    void %s::init(struct ::wl_display *display, int version)\n", interfaceName);
             printf("    {\n");
             printf("        m_global = wl_global_create(display, &::%s_interface, version, this, bind_func);\n", interfaceName);
@@ -679,6 +693,12 @@ void process(QXmlStreamReader &xml, const QByteArray &headerPath, const QByteArr
             printf("        Resource *resource = Resource::fromResource(client_resource);\n");
             printf("        %s *that = resource->%s_object;\n", interfaceName, interfaceNameStripped);
             printf("        that->m_resource_map.remove(resource->client(), resource);\n");
+            printf("        QHash<struct ::wl_client*, QVector<Resource*> >::iterator it = that->m_client_resources.find(resource->client());\n");
+            printf("        if (it != that->m_client_resources.end()) {\n");
+            printf("            it->removeOne(resource);\n");
+            printf("            if (it->isEmpty())\n");
+            printf("                that->m_client_resources.erase(it);\n");
+            printf("        }\n");
             printf("        that->%s_destroy_resource(resource);\n", interfaceNameStripped);
             printf("        delete resource;\n");
             printf("#if !WAYLAND_VERSION_CHECK(1, 2, 0)\n");
@@ -35,6 +35,8 @@
 #include <QMimeData>
 #include <QPixmap>
 #include <QDrag>
+#include <qpa/qplatformnativeinterface.h>
+#include <QtWaylandClient/private/qwaylandwindow_p.h>
 
 #include <QtTest/QtTest>
 
@@ -143,6 +145,7 @@ private slots:
     void touchDrag();
     void mouseDrag();
     void dontCrashOnMultipleCommits();
+    void swapDamage();
 
 private:
     MockCompositor *compositor;
@@ -360,6 +363,41 @@ void tst_WaylandClient::dontCrashOnMultipleCommits()
     QTRY_VERIFY(!compositor->surface());
 }
 
+// The EGL integration can't be loaded against the mock compositor, so this
+// checks what reaches the window through the native interface and the
+// rectangles that would be passed to eglSwapBuffersWithDamage
+void tst_WaylandClient::swapDamage()
+{
+    TestWindow window;
+    window.show();
+
+    QSharedPointer<MockSurface> surface;
+    QTRY_VERIFY(surface = compositor->surface());
+
+    QPlatformNativeInterface *native = QGuiApplication::platformNativeInterface();
+    typedef void (*SetSwapDamage)(QWindow *, const QRegion &);
+    typedef int (*BufferAge)(QWindow *);
+    SetSwapDamage setSwapDamage = reinterpret_cast<SetSwapDamage>(native->platformFunction("WaylandWindowFunctionsSetSwapDamage"));
+    BufferAge bufferAge = reinterpret_cast<BufferAge>(native->platformFunction("WaylandWindowFunctionsBufferAge"));
+    QVERIFY(setSwapDamage);
+    QVERIFY(bufferAge);
+
+    // Only OpenGL windows know the age of their buffers
+    QCOMPARE(bufferAge(&window), 0);
+
+    QRegion damage(1, 2, 3, 4);
+    damage |= QRect(10, 20, 5, 5);
+    setSwapDamage(&window, damage);
+
+    // Flipped against the height passed in, not the window's
+    QtWaylandClient::QWaylandWindow *waylandWindow = static_cast<QtWaylandClient::QWaylandWindow *>(window.handle());
+    QCOMPARE(waylandWindow->takeSwapDamageRects(64),
+             QVector<int>() << 1 << 58 << 3 << 4 << 10 << 39 << 5 << 5);
+
+    // Damage only applies to one swap
+    QVERIFY(waylandWindow->takeSwapDamageRects(64).isEmpty());
+}
+
 int main(int argc, char **argv)
 {
     setenv("XDG_RUNTIME_DIR", ".", 1);
@@ -47,6 +47,7 @@ const struct wl_registry_listener MockClient::registryListener = {
 MockClient::MockClient()
     : display(wl_display_connect("wayland-qt-test-0"))
     , compositor(0)
+    , subCompositor(nullptr)
     , output(0)
     , registry(0)
     , wlshell(0)
@@ -169,6 +170,8 @@ void MockClient::handleGlobal(uint32_t id, const QByteArray &interface)
 {
     if (interface == "wl_compositor") {
         compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+    } else if (interface == "wl_subcompositor") {
+        subCompositor = static_cast<wl_subcompositor *>(wl_registry_bind(registry, id, &wl_subcompositor_interface, 1));
     } else if (interface == "wl_output") {
         output = static_cast<wl_output *>(wl_registry_bind(registry, id, &wl_output_interface, 2));
         wl_output_add_listener(output, &outputListener, this);
@@ -64,6 +64,7 @@ public:
 
     wl_display *display;
     wl_compositor *compositor;
+    wl_subcompositor *subCompositor;
     wl_output *output;
     wl_shm *shm;
     wl_registry *registry;
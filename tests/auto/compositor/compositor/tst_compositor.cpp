@@ -41,6 +41,9 @@
 #include <QtWaylandCompositor/QWaylandIviSurface>
 #include <QtWaylandCompositor/QWaylandSurface>
 #include <QtWaylandCompositor/QWaylandResource>
+#include <QtWaylandCompositor/private/qwaylandsurface_p.h>
+#include <QtWaylandCompositor/private/qwlclientbuffer_p.h>
+#include <QtWaylandCompositor/private/qwlclientbuffercache_p.h>
 #include <qwayland-xdg-shell.h>
 #include <qwayland-ivi-application.h>
 
@@ -63,6 +66,11 @@ private slots:
     void sizeFollowsWindow();
     void mapSurface();
     void frameCallback();
+    void hiddenFrameCallbacks();
+    void synchronizedSubsurface();
+    void opaqueRegion();
+    void clientBufferCache();
+    void bufferDamageHistory();
 
     void advertisesXdgShellSupport();
     void createsXdgSurfaces();
@@ -371,6 +379,261 @@ void tst_WaylandCompositor::frameCallback()
     wl_surface_destroy(surface);
 }
 
+void tst_WaylandCompositor::hiddenFrameCallbacks()
+{
+    TestCompositor compositor;
+    compositor.create();
+    QWaylandOutput *output = compositor.defaultOutput();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+
+    QWaylandView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(output);
+    view.setVisible(false);
+
+    ShmBuffer buffer(QSize(16, 16), client.shm);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(waylandSurface->hasContent(), true);
+
+    QWaylandSurfacePrivate *surfacePrivate = QWaylandSurfacePrivate::get(waylandSurface);
+
+    // Off by default
+    QCOMPARE(output->hiddenFrameCallbackInterval(), 0);
+
+    // Suspended while no view is visible
+    output->setHiddenFrameCallbackInterval(-1);
+    int frameCounter = 0;
+    registerFrameCallback(surface, &frameCounter);
+    wl_surface_commit(surface);
+    QTRY_VERIFY(surfacePrivate->hasFrameCallbacksToSend());
+    output->frameStarted();
+    output->sendFrameCallbacks();
+    QVERIFY(surfacePrivate->hasFrameCallbacksToSend());
+    QCOMPARE(frameCounter, 0);
+
+    view.setVisible(true);
+    output->frameStarted();
+    output->sendFrameCallbacks();
+    QVERIFY(!surfacePrivate->hasFrameCallbacksToSend());
+    QTRY_COMPARE(frameCounter, 1);
+
+    // Throttled, but still sent once due without a new frame
+    view.setVisible(false);
+    output->setHiddenFrameCallbackInterval(60 * 60 * 1000);
+    registerFrameCallback(surface, &frameCounter);
+    wl_surface_commit(surface);
+    QTRY_VERIFY(surfacePrivate->hasFrameCallbacksToSend());
+    output->frameStarted();
+    output->sendFrameCallbacks();
+    QVERIFY(surfacePrivate->hasFrameCallbacksToSend());
+    QCOMPARE(frameCounter, 1);
+
+    output->setHiddenFrameCallbackInterval(100);
+    output->sendFrameCallbacks();
+    QTRY_COMPARE_WITH_TIMEOUT(frameCounter, 2, 10000);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::synchronizedSubsurface()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    QTRY_VERIFY(client.subCompositor);
+
+    wl_surface *parentSurface = client.createSurface();
+    wl_surface *childSurface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    QWaylandSurface *waylandParent = compositor.surfaces.at(0);
+    QWaylandSurface *waylandChild = compositor.surfaces.at(1);
+
+    wl_subsurface *subsurface = wl_subcompositor_get_subsurface(client.subCompositor, childSurface, parentSurface);
+    QSignalSpy positionSpy(waylandChild, SIGNAL(subsurfacePositionChanged(const QPoint &)));
+
+    QSize size(32, 32);
+    ShmBuffer childBuffer(size, client.shm);
+    wl_subsurface_set_position(subsurface, 10, 20);
+    wl_surface_attach(childSurface, childBuffer.handle, 0, 0);
+    wl_surface_damage(childSurface, 0, 0, size.width(), size.height());
+    wl_surface_commit(childSurface);
+
+    // Subsurfaces start out synchronized, so nothing changes until the parent is committed
+    client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 3);
+    QCOMPARE(waylandChild->hasContent(), false);
+    QCOMPARE(positionSpy.count(), 0);
+
+    ShmBuffer parentBuffer(size, client.shm);
+    wl_surface_attach(parentSurface, parentBuffer.handle, 0, 0);
+    wl_surface_commit(parentSurface);
+
+    QTRY_COMPARE(waylandParent->hasContent(), true);
+    QCOMPARE(waylandChild->hasContent(), true);
+    QCOMPARE(positionSpy.count(), 1);
+    QCOMPARE(positionSpy.at(0).at(0).toPoint(), QPoint(10, 20));
+
+    // Desynchronized subsurfaces get updated on their own
+    QSignalSpy damagedSpy(waylandChild, SIGNAL(damaged(const QRegion &)));
+    wl_subsurface_set_desync(subsurface);
+    wl_surface_attach(childSurface, nullptr, 0, 0);
+    wl_surface_commit(childSurface);
+    QTRY_COMPARE(damagedSpy.count(), 1);
+    QCOMPARE(waylandChild->hasContent(), false);
+
+    wl_subsurface_set_sync(subsurface);
+    wl_surface_attach(childSurface, childBuffer.handle, 0, 0);
+    wl_surface_damage(childSurface, 0, 0, size.width(), size.height());
+    wl_surface_commit(childSurface);
+    client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 4);
+    QCOMPARE(waylandChild->hasContent(), false);
+
+    // Once the subsurface is gone, the cached state and later commits are applied right away
+    wl_subsurface_destroy(subsurface);
+    QTRY_COMPARE(waylandChild->hasContent(), true);
+    QCOMPARE(damagedSpy.count(), 2);
+
+    wl_surface_attach(childSurface, nullptr, 0, 0);
+    wl_surface_commit(childSurface);
+    QTRY_COMPARE(damagedSpy.count(), 3);
+    QCOMPARE(waylandChild->hasContent(), false);
+
+    wl_surface_destroy(childSurface);
+    wl_surface_destroy(parentSurface);
+}
+
+void tst_WaylandCompositor::opaqueRegion()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    QSignalSpy opaqueSpy(waylandSurface, SIGNAL(opaqueRegionChanged()));
+
+    QSize size(32, 32);
+    ShmBuffer buffer(size, client.shm);
+    wl_region *region = wl_compositor_create_region(client.compositor);
+    wl_region_add(region, 0, 0, 64, 64);
+    wl_surface_set_opaque_region(surface, region);
+    wl_region_destroy(region);
+
+    // The opaque region is double-buffered
+    client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    QCOMPARE(opaqueSpy.count(), 0);
+    QCOMPARE(waylandSurface->isOpaque(), false);
+
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+    QTRY_COMPARE(opaqueSpy.count(), 1);
+    QCOMPARE(waylandSurface->opaqueRegion(), QRegion(0, 0, 32, 32));
+    QCOMPARE(waylandSurface->isOpaque(), true);
+
+    wl_surface_set_opaque_region(surface, nullptr);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(opaqueSpy.count(), 2);
+    QCOMPARE(waylandSurface->isOpaque(), false);
+
+    wl_surface_destroy(surface);
+}
+
+class TestClientBuffer : public QtWayland::ClientBuffer
+{
+public:
+    TestClientBuffer(const QSize &size = QSize()) : ClientBuffer(nullptr), m_size(size) {}
+    QSize size() const override { return m_size; }
+    QWaylandSurface::Origin origin() const override { return QWaylandSurface::OriginTopLeft; }
+#if QT_CONFIG(opengl)
+    QOpenGLTexture *toOpenGlTexture(int) override { return nullptr; }
+#endif
+
+private:
+    QSize m_size;
+};
+
+void tst_WaylandCompositor::clientBufferCache()
+{
+    typedef QVector<QtWayland::ClientBuffer *> Buffers;
+    QtWayland::ClientBufferCache cache;
+    cache.setLimit(300);
+
+    TestClientBuffer a, b, c, d;
+    cache.insert(&a, 100);
+    cache.insert(&b, 100);
+    cache.insert(&c, 100);
+    QCOMPARE(cache.cost(), qint64(300));
+    QCOMPARE(cache.evict(&c), Buffers());
+
+    // Going over the limit evicts the least recently used buffers
+    cache.use(&a);
+    cache.insert(&d, 100);
+    QCOMPARE(cache.cost(), qint64(400));
+    QCOMPARE(cache.evict(&d), Buffers() << &b);
+    QVERIFY(!cache.contains(&b));
+    QCOMPARE(cache.cost(), qint64(300));
+
+    // Committed buffers and the buffer being used are kept
+    QRegion damage;
+    c.setCommitted(damage);
+    cache.setLimit(100);
+    QCOMPARE(cache.evict(&d), Buffers() << &a);
+    QVERIFY(cache.contains(&c));
+    QVERIFY(cache.contains(&d));
+    QCOMPARE(cache.cost(), qint64(200));
+
+    // Destroyed buffers give back what they cost
+    QVERIFY(cache.remove(&c));
+    QVERIFY(!cache.remove(&c));
+    QCOMPARE(cache.cost(), qint64(100));
+    QCOMPARE(cache.count(), 1);
+    QCOMPARE(cache.evict(&d), Buffers());
+}
+
+void tst_WaylandCompositor::bufferDamageHistory()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    QWaylandSurfacePrivate *surfacePrivate = QWaylandSurfacePrivate::get(compositor.surfaces.at(0));
+
+    const QSize size(100, 100);
+    const QRegion all(QRect(QPoint(), size));
+    TestClientBuffer a(size), b(size), c(size);
+
+    // New buffers are damaged entirely
+    QCOMPARE(surfacePrivate->commitBufferDamage(&a, QRect(0, 0, 10, 10)), all);
+    QCOMPARE(surfacePrivate->commitBufferDamage(&b, QRect(10, 0, 10, 10)), all);
+
+    // A buffer that comes back is also damaged by what was committed in between
+    QCOMPARE(surfacePrivate->commitBufferDamage(&a, QRect(20, 0, 10, 10)), QRegion(10, 0, 20, 10));
+    QCOMPARE(surfacePrivate->commitBufferDamage(&b, QRect(30, 0, 10, 10)), QRegion(20, 0, 20, 10));
+
+    // Committing the same buffer again only damages what it was committed with
+    QCOMPARE(surfacePrivate->commitBufferDamage(&b, QRect(50, 50, 5, 5)), QRegion(50, 50, 5, 5));
+
+    // Once the history doesn't go back far enough, everything is damaged
+    for (int i = 0; i < QWaylandSurfacePrivate::MaxDamageHistory; ++i)
+        surfacePrivate->commitBufferDamage(&c, QRect(0, 0, 1, 1));
+    QCOMPARE(surfacePrivate->commitBufferDamage(&a, QRect(0, 0, 1, 1)), all);
+
+    wl_surface_destroy(surface);
+}
+
 void tst_WaylandCompositor::seatCapabilities()
 {
     TestCompositor compositor;